@@ -3,7 +3,7 @@
 namespace basics
 {
 
-common::Hashmap<500> hashmap;
+common::Hashmap<503> hashmap;
 std::map<int, common::int_holder> stl_map;
 
 static inline char basic_get_operation()
@@ -185,6 +185,252 @@ static void real_test_case()
 }
 
 
+namespace erase_tests
+{
+
+common::Hashmap<2000003> hashmap;
+std::map<int, common::int_holder> stl_map;
+
+static inline char get_operation()
+{
+    const int r = rand()%3;
+    return (r == 0)? 'I' : (r == 1)? 'E' : 'M';
+}
+
+static void erase_test_case()
+{
+    constexpr unsigned operations_number {20000000};
+    constexpr unsigned uniwersum_size {2000000};
+
+    unsigned members_hits {0};
+    unsigned stl_members_hits {0};
+
+    hashmap.reset();
+    stl_map.clear();
+
+    common::int_holder basic_config;
+    basic_config.mark = false;
+
+    printf("\n%s\n\n", __FUNCTION__);
+    printf("hashmap capacity = %u, operations_number = %u, uniwersum_size = %u\n",
+           hashmap.capacity(), operations_number, uniwersum_size);
+
+    srand(time(nullptr));
+
+    for (unsigned i = 0; i < operations_number; i++)
+    {
+        const char operation = get_operation();
+        basic_config.content = (rand()%uniwersum_size);
+
+        if (operation == 'I')
+        {
+            hashmap.insert(basic_config);
+            stl_map[basic_config.content] = basic_config;
+            assert(hashmap.member(basic_config));
+        }
+        else
+            if (operation == 'E')
+            {
+                hashmap.erase(basic_config);
+                stl_map.erase(basic_config.content);
+                assert(!hashmap.member(basic_config));
+            }
+            else
+            {
+                if (hashmap.member(basic_config))
+                    members_hits++;
+                if (stl_map.find(basic_config.content) != stl_map.end())
+                    stl_members_hits++;
+            }
+        assert(hashmap.size() == stl_map.size());
+    }
+
+    printf("Summary\n");
+    printf("hits = %u, stl hits = %u, hashmap.size = %u, stl map size = %zu, compactions = %u\n",
+           members_hits, stl_members_hits, hashmap.size(), stl_map.size(), hashmap.compactions);
+
+    assert(members_hits == stl_members_hits);
+    assert(hashmap.size() == stl_map.size());
+    for (auto &item : stl_map)
+    {
+        basic_config.content = item.first;
+        assert(hashmap.member(basic_config));
+    }
+    printf("OK :)\n");
+}
+
+}
+
+
+namespace division_free_tests
+{
+
+template<class Hashmap, class Holder>
+static void real_test_case_against_stl(Hashmap &hashmap, const char *name)
+{
+    constexpr unsigned operations_number {3000000};
+    constexpr unsigned uniwersum_size {1000000};
+    std::map<int, Holder> stl_map;
+
+    Holder basic_config;
+    basic_config.mark = false;
+
+    printf("\n%s %s\n\n", __FUNCTION__, name);
+    hashmap.reset();
+    srand(time(nullptr));
+
+    unsigned members_hits {0};
+    unsigned stl_members_hits {0};
+    for (unsigned i = 0; i < operations_number; i++)
+    {
+        const int r = rand()%3;
+        basic_config.content = (rand()%uniwersum_size);
+        if (r == 0)
+        {
+            hashmap.insert(basic_config);
+            stl_map[basic_config.content] = basic_config;
+        }
+        else
+            if (r == 1)
+            {
+                hashmap.erase(basic_config);
+                stl_map.erase(basic_config.content);
+            }
+            else
+            {
+                if (hashmap.member(basic_config))
+                    members_hits++;
+                if (stl_map.find(basic_config.content) != stl_map.end())
+                    stl_members_hits++;
+            }
+    }
+    printf("hits = %u, stl hits = %u, hashmap.size = %u, stl map size = %zu, collisions = %u\n",
+           members_hits, stl_members_hits, hashmap.size(), stl_map.size(), hashmap.collisions);
+
+    assert(members_hits == stl_members_hits);
+    assert(hashmap.size() == stl_map.size());
+    printf("OK :)\n");
+}
+
+common::Hashmap<1048576, common::fastrange_int_holder, common::Pow2_quadratic_hash> pow2_hashmap;
+common::Hashmap<1000003, common::fastrange_int_holder, common::Fastrange_linear_hash> fastrange_hashmap;
+
+static void real_test_case()
+{
+    real_test_case_against_stl<decltype(pow2_hashmap), common::fastrange_int_holder>(pow2_hashmap,
+                                                                                     "Pow2_quadratic_hash");
+    real_test_case_against_stl<decltype(fastrange_hashmap), common::fastrange_int_holder>(fastrange_hashmap,
+                                                                                          "Fastrange_linear_hash");
+}
+
+}
+
+namespace hasher_tests
+{
+
+common::Hashmap<1000003, common::int_holder, common::Linear_hash, common::Murmur3_hasher> murmur3_hashmap;
+common::Hashmap<1048576, common::int_holder, common::Pow2_quadratic_hash, common::Wy_hasher> wy_hashmap;
+
+static void real_test_case()
+{
+    division_free_tests::real_test_case_against_stl<decltype(murmur3_hashmap), common::int_holder>(
+                murmur3_hashmap, "Linear_hash + Murmur3_hasher");
+    division_free_tests::real_test_case_against_stl<decltype(wy_hashmap), common::int_holder>(
+                wy_hashmap, "Pow2_quadratic_hash + Wy_hasher");
+}
+
+}
+
+namespace bloom_filter_tests
+{
+
+common::Hashmap<1000003, common::int_holder, common::Limited_quadratic_hash, common::Identity_hasher,
+                common::Blocked_bloom_filter> filtered_hashmap;
+
+// erase + compact() path is what can break the filter, insert only tests would not catch it
+static void real_test_case()
+{
+    division_free_tests::real_test_case_against_stl<decltype(filtered_hashmap), common::int_holder>(
+                filtered_hashmap, "Limited_quadratic_hash + Blocked_bloom_filter");
+    printf("compactions = %u\n", filtered_hashmap.compactions);
+}
+
+}
+
+
+namespace probe_kernel_tests
+{
+
+constexpr unsigned capacity {100003};
+common::Hashmap<capacity> hashmap;
+
+// gather kernels have to stop where Iter3 does: on the key (live or tombstone) or on the first empty slot
+template<class Kernel>
+static void compare_with_iter3(const std::vector<int> &keys, const char *name)
+{
+    common::int_holder c;
+    c.mark = false;
+    unsigned mismatches {0};
+    for (auto key : keys)
+    {
+        c.content = key;
+        if (Kernel::process_search__true__optimized(hashmap.table, c)
+                != common::Iter3<capacity>::process_search__true__optimized(hashmap.table, c))
+            mismatches++;
+    }
+    printf("%s: searches = %zu, mismatches = %u\n", name, keys.size(), mismatches);
+    assert(mismatches == 0);
+}
+
+static void compare_kernels(const std::vector<int> &keys, const char *what)
+{
+    printf("%s\n", what);
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        compare_with_iter3<common::Iter5_AVX2<capacity>>(keys, "    Iter5_AVX2  ");
+    if (__builtin_cpu_supports("avx512f"))
+        compare_with_iter3<common::Iter6_AVX512<capacity>>(keys, "    Iter6_AVX512");
+    compare_with_iter3<common::IterDispatch<capacity>>(keys, "    IterDispatch");
+}
+
+// alpha 0.9 as in fast_member, 5% of keys erased so that tombstones stay (compaction starts at 20%)
+static void real_test_case()
+{
+    printf("\n%s\n\n", __FUNCTION__);
+    constexpr unsigned uniwersum_size {1000000000};
+    hashmap.reset();
+    srand(time(nullptr));
+
+    common::int_holder c;
+    c.mark = false;
+    std::vector<int> hits, misses, erased;
+    while (hashmap.size() < 9*capacity/10)
+    {
+        c.content = rand()%uniwersum_size;
+        hashmap.insert(c);
+        hits.push_back(c.content);
+    }
+    erased.assign(hits.begin(), hits.begin() + hits.size()/20);
+    hits.erase(hits.begin(), hits.begin() + hits.size()/20);
+    for (auto key : erased)
+    {
+        c.content = key;
+        hashmap.erase(c);
+    }
+    for (unsigned i = 0; i < hits.size(); i++)
+        misses.push_back(rand()%uniwersum_size);
+    printf("kernel = %s, size = %u, compactions = %u\n", common::probe_kernel_name(common::selected_probe_kernel()),
+           hashmap.size(), hashmap.compactions);
+    assert(hashmap.compactions == 0);
+
+    compare_kernels(hits, "hits");
+    compare_kernels(misses, "misses");
+    compare_kernels(erased, "tombstones");
+    printf("OK :)\n");
+}
+
+}
+
 namespace hashmap_tests
 {
 
@@ -385,5 +631,10 @@ int main()
 
     real_tests::real_test_case();
     hashmap_tests::real_test_case_only_hashmap();
+    erase_tests::erase_test_case();
+    division_free_tests::real_test_case();
+    hasher_tests::real_test_case();
+    bloom_filter_tests::real_test_case();
+    probe_kernel_tests::real_test_case();
     return 0;
 }
@@ -1,17 +1,20 @@
 ﻿#pragma once
 
 #include <cstdio>
+#include <cstdint>
 #include <utility>
 #include <cassert>
 #include <ctime>
 #include <cstdlib>
 #include <vector>
+#include <array>
 #include <map>
 #include <unordered_map>
 #include <algorithm>
 #include <cmath>
 #include <emmintrin.h>
 #include <smmintrin.h>
+#include <immintrin.h>
 
 namespace common
 {
@@ -33,7 +36,7 @@ struct int_holder final
         return content == INF;
     }
 
-    bool operator==(const int_holder& holder)
+    bool operator==(const int_holder& holder) const
     {
         return (content == holder.content);
     }
@@ -44,11 +47,191 @@ struct int_holder final
     }
 } __attribute__((packed));
 
+/*
+ * int_holder without division: murmur3 finalizer mixes the key and Lemire's fastrange (h*m) >> 32
+ * maps it to [0, m) for any m. For m being power of two that is plain multiply-shift (top bits of h).
+ */
+struct fastrange_int_holder final
+{
+    int content;
+    bool mark;
+
+    void init_as_empty()
+    {
+        content = INF;
+    }
+
+    bool is_empty() const
+    {
+        return content == INF;
+    }
+
+    bool operator==(const fastrange_int_holder& holder) const
+    {
+        return (content == holder.content);
+    }
+
+    static uint32_t mix(uint32_t x)
+    {
+        x ^= x >> 16;
+        x *= 0x85ebca6bu;
+        x ^= x >> 13;
+        x *= 0xc2b2ae35u;
+        x ^= x >> 16;
+        return x;
+    }
+
+    static int hash(const fastrange_int_holder& holder, int m)
+    {
+        return int((uint64_t(mix(uint32_t(holder.content)))*uint32_t(m)) >> 32);
+    }
+} __attribute__((packed));
+
+/*
+ * Hashers: Holder content -> home slot in [0, m). Identity keeps Holder::hash, the others mix
+ * the key first so strided or clustered keys don't end up in neighbouring slots.
+ */
+struct Identity_hasher final
+{
+    template<class Holder>
+    static int home(const Holder& holder, int m)
+    {
+        return Holder::hash(holder, m);
+    }
+};
+
+template<class Mixer>
+struct Mixing_hasher
+{
+    // fastrange on the top half of the mix, the low bits of a weak mixer are the worst ones
+    template<class Holder>
+    static int home(const Holder& holder, int m)
+    {
+        const auto h = uint32_t(Mixer::mix(uint64_t(uint32_t(holder.content))) >> 32);
+        return int((uint64_t(h)*uint32_t(m)) >> 32);
+    }
+};
+
+struct Murmur3_hasher final : Mixing_hasher<Murmur3_hasher>
+{
+    // murmur3 fmix64
+    static uint64_t mix(uint64_t x)
+    {
+        x ^= x >> 33;
+        x *= UINT64_C(0xff51afd7ed558ccd);
+        x ^= x >> 33;
+        x *= UINT64_C(0xc4ceb9fe1a85ec53);
+        x ^= x >> 33;
+        return x;
+    }
+};
+
+struct Wy_hasher final : Mixing_hasher<Wy_hasher>
+{
+    // wyhash/xxh3 style 64x64->128 multiply of two salted copies of the key folded to 64 bits
+    static uint64_t mix(uint64_t x)
+    {
+        __extension__ typedef unsigned __int128 uint128;
+        const uint128 r = uint128(x ^ UINT64_C(0xa0761d6478bd642f))*(x ^ UINT64_C(0xe7037ed1a0b428db));
+        return uint64_t(r) ^ uint64_t(r >> 64);
+    }
+};
+
+/*
+ * Filters consulted by member() before the probe loop. No_filter is a no-op for any Holder,
+ * Blocked_bloom_filter answers most misses from one cache line without touching the table.
+ */
+struct No_filter final
+{
+    explicit No_filter(unsigned) {}
+
+    template<class Key>
+    void insert(const Key&) {}
+
+    template<class Key>
+    bool may_contain(const Key&) const
+    {
+        return true;
+    }
+
+    void clear() {}
+};
+
+/*
+ * Blocked Bloom filter: key maps to one 64-byte block of 16 words and sets one bit per word,
+ * bit i is the top 5 bits of hash*salt[i]. SSE4.1 has no per lane variable shift, so 1 << s is built
+ * as float 2^s (exponent s + 127) converted back to int; for s = 31 the conversion overflows
+ * to 0x80000000 which is the wanted bit anyway. No erase - Hashmap rebuilds it in compact().
+ */
+class Blocked_bloom_filter final
+{
+public:
+    explicit Blocked_bloom_filter(unsigned keys, unsigned bits_per_key = 16)
+        : blocks(std::max<uint64_t>(1, (uint64_t(keys)*bits_per_key + 511)/512))
+    {
+    }
+
+    template<class Key>
+    void insert(const Key &key)
+    {
+        const uint64_t h = Murmur3_hasher::mix(uint64_t(uint32_t(key)));
+        block &b = blocks[index(h)];
+        for (unsigned i = 0; i < 16; i++)
+            b.word[i] |= 1u << ((uint32_t(h)*salts[i]) >> 27);
+    }
+
+    template<class Key>
+    bool may_contain(const Key &key) const
+    {
+        const uint64_t h = Murmur3_hasher::mix(uint64_t(uint32_t(key)));
+        const block &b = blocks[index(h)];
+        const __m128i H = _mm_set1_epi32(int(uint32_t(h)));
+        const __m128i BIAS = _mm_set1_epi32(127);
+        for (unsigned i = 0; i < 16; i += 4)
+        {
+            const __m128i SALT = _mm_load_si128((const __m128i*)(salts + i));
+            const __m128i SHIFT = _mm_srli_epi32(_mm_mullo_epi32(H, SALT), 27);
+            const __m128i MASK = _mm_cvttps_epi32(_mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(SHIFT, BIAS), 23)));
+            // (~block & mask) == 0
+            if (!_mm_testc_si128(_mm_load_si128((const __m128i*)(b.word + i)), MASK))
+                return false;
+        }
+        return true;
+    }
+
+    void clear()
+    {
+        std::fill(blocks.begin(), blocks.end(), block());
+    }
+
+private:
+    struct alignas(64) block
+    {
+        uint32_t word[16] = {};
+    };
+
+    alignas(16) static constexpr uint32_t salts[16] = {
+        0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du, 0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u,
+        0x9e3779b1u, 0x85ebca77u, 0xc2b2ae3du, 0x27d4eb2fu, 0x165667b1u, 0xd3a2646du, 0xfd7046c5u, 0xb55a4f09u
+    };
+
+    unsigned index(uint64_t h) const
+    {
+        return unsigned(((h >> 32)*blocks.size()) >> 32);
+    }
+
+    std::vector<block> blocks;
+};
+
+constexpr uint32_t Blocked_bloom_filter::salts[16];
+
 class Linear_hash;
 class Limited_quadratic_hash;
 class Limited_linear_hash;
 class Limited_linear_hash_prime;
 class Double_hash;
+class Pow2_quadratic_hash;
+class Fastrange_linear_hash;
 
 struct Iter0;
 struct Iter1;
@@ -57,15 +240,27 @@ struct Iter4_Broken_But_Fast;
 template<unsigned>
 struct Iter3;
 
+template<unsigned>
+struct Iter5_AVX2;
+
+template<unsigned>
+struct Iter6_AVX512;
+
+template<unsigned>
+struct IterDispatch;
+
 template<unsigned Size,
          class Holder = int_holder,
-         class Hash = Limited_quadratic_hash>
+         class Hash = Limited_quadratic_hash,
+         class Hasher = Identity_hasher,
+         class Filter = No_filter>
 class Hashmap
 {
 public:
     using key_type = Holder;
 
-    Hashmap()
+    explicit Hashmap(float tombstone_ratio = 0.2f)
+        : compaction_threshold(unsigned(tombstone_ratio*Size)), filter(Size)
     {
         for (auto &e : table)
         {
@@ -77,9 +272,13 @@ public:
     void insert(Holder &c)
     {
         const int i = process_search__false(c);
-        if (!(table[i] == c))
+        if (table[i].is_empty() || table[i].mark)
         {
-            table[i] = std::move(c);
+            if (table[i].mark)
+                tombstones--;
+            table[i] = c;
+            table[i].mark = false;
+            filter.insert(c.content);
             n++;
         }
     }
@@ -87,17 +286,23 @@ public:
     void erase(Holder &c)
     {
         const int i = process_search__true(c);
-        if (table[i] == c)
+        if (!table[i].is_empty())
         {
-            c.mark = true;
+            // content stays, so probe sequences running through the slot still reach their keys
+            table[i].mark = true;
+            tombstones++;
             n--;
+            if (tombstones > compaction_threshold)
+                compact();
         }
     }
 
     bool member(Holder &c)
     {
+        if (!filter.may_contain(c.content))
+            return false;
         int i = process_search__true(c);
-        return (table[i] == c);
+        return !table[i].is_empty();
     }
 
     bool find(Holder &c) { return member(c); }
@@ -120,28 +325,37 @@ public:
     void reset()
     {
         n = 0;
+        tombstones = 0;
         collisions = 0;
         for (auto &e : table)
         {
             e.mark = false;
             e.init_as_empty();
         }
+        filter.clear();
     }
 
     void clear() { reset(); }
 
     unsigned collisions {0};
+    unsigned compactions {0};
 
 protected:
 
+    bool is_live(const Holder &e, const Holder &c) const
+    {
+        return (e == c) && !e.mark;
+    }
+
+    // tombstones are skipped, stops on live c or empty slot
     int process_search__true(Holder &c)
     {
         const int m = table.size();
-        const int hash_holder = Holder::hash(c, m);
+        const int hash_holder = Hasher::home(c, m);
         int j = 0;
         int i = Hash::h(hash_holder, j, m);
 
-        while ( !(table[i] == c) && (!table[i].is_empty()))
+        while ( !is_live(table[i], c) && (!table[i].is_empty()))
         {
             j++;
             i = Hash::h(hash_holder, j, m);
@@ -150,26 +364,77 @@ protected:
         return i;
     }
 
+    // slot of live c if present, otherwise the first tombstone or empty slot on its probe sequence
     int process_search__false(Holder &c)
     {
         const int m = table.size();
-        const int hash_holder = Holder::hash(c, m);
+        const int hash_holder = Hasher::home(c, m);
         int j = 0;
         int i = Hash::h(hash_holder, j, m);
+        int reusable = -1;
 
-        while ( !(table[i] == c) && (!table[i].is_empty()) && !table[i].mark)
+        while ( !is_live(table[i], c) && (!table[i].is_empty()))
         {
+            if (table[i].mark && reusable < 0)
+                reusable = i;
             j++;
             i = Hash::h(hash_holder, j, m);
             collisions++;
         }
-        return i;
+        return (!table[i].is_empty() || reusable < 0)? i : reusable;
+    }
+
+    /*
+     * In-place rehash which drops tombstones. Live entries get mark as "pending" and each one is moved
+     * to the first empty or pending slot of its probe sequence, swapping a pending occupant out
+     * to be placed next. Settled entries never move again.
+     */
+    void compact()
+    {
+        compactions++;
+        const int m = table.size();
+        for (auto &e : table)
+        {
+            if (e.mark)
+            {
+                e.mark = false;
+                e.init_as_empty();
+            }
+            else if (!e.is_empty())
+                e.mark = true;
+        }
+        for (int i = 0; i < m; i++)
+        {
+            while (table[i].mark)
+            {
+                const int hash_holder = Hasher::home(table[i], m);
+                int j = 0;
+                int target = Hash::h(hash_holder, j, m);
+                while (!table[target].is_empty() && !table[target].mark)
+                {
+                    j++;
+                    target = Hash::h(hash_holder, j, m);
+                }
+                table[i].mark = false;
+                if (target == i)
+                    break;
+                std::swap(table[i], table[target]);
+            }
+        }
+        tombstones = 0;
+        // erased keys stay in the filter until here
+        filter.clear();
+        for (auto &e : table)
+            if (!e.is_empty())
+                filter.insert(e.content);
     }
 
     unsigned n {0};
+    unsigned tombstones {0};
+    unsigned compaction_threshold;
+    Filter filter;
 public:
-    static_assert((Size == 50000021) || (Size == 10000019) || (Size == 4000037) || (Size == 2000003) || (Size == 200003)
-                  || (Size == 100003) || (Size == 500), "Size not supported");
+    static_assert(Hash::valid_capacity(Size), "Size not supported by Hash");
     std::array<Holder, Size> table;
 };
 
@@ -182,7 +447,7 @@ public:
     using Hashmap<Size, Hash>::process_search__true;
 
     template<
-            template<unsigned> class Func = Iter3
+            template<unsigned> class Func = IterDispatch
             >
     bool fast_member(int_holder &c)
     {
@@ -195,13 +460,28 @@ public:
         {
             i = process_search__true(c);
         }
-        return (table[i] == c);
+        return (table[i] == c) && !table[i].mark;
     }
 };
 
+constexpr bool is_prime(unsigned m)
+{
+    if (m < 2)
+        return false;
+    for (unsigned i = 2; i*i <= m; i++)
+        if (m % i == 0)
+            return false;
+    return true;
+}
+
 class Linear_hash final
 {
 public:
+    static constexpr bool valid_capacity(unsigned m)
+    {
+        return m > 0;
+    }
+
     static int h1(int x, int m)
     {
         return x % m;
@@ -216,6 +496,11 @@ public:
 class Limited_quadratic_hash final
 {
 public:
+    // k + j + j^2 reaches (m+1)/2 distinct slots only for prime m, otherwise a probe may never find a free one
+    static constexpr bool valid_capacity(unsigned m)
+    {
+        return is_prime(m);
+    }
 
 	static int h(int k, int j, int m)
 	{
@@ -229,6 +514,11 @@ public:
 class Limited_linear_hash final
 {
 public:
+    static constexpr bool valid_capacity(unsigned m)
+    {
+        return m > 0;
+    }
+
     static int h1(int x, int m)
     {
         return x % m;
@@ -247,6 +537,11 @@ constexpr int b {7};
 class Limited_linear_hash_prime final
 {
 public:
+    static constexpr bool valid_capacity(unsigned m)
+    {
+        return m > 0;
+    }
+
     static int h1(int x, int m)
     {
         return ((a*x + b) % p) % m;
@@ -264,6 +559,11 @@ public:
 class Double_hash final
 {
 public:
+    static constexpr bool valid_capacity(unsigned m)
+    {
+        return is_prime(m);
+    }
+
     static int h1(int x, int m)
     {
         return x % m;
@@ -280,6 +580,44 @@ public:
 	}
 };
 
+/*
+ * Division free probing for power of two m: triangular steps k + j(j+1)/2 visit every slot
+ * and wrap-around is a mask. Unsigned arithmetic keeps the sequence right modulo 2^31 even
+ * when j(j+1) overflows.
+ */
+class Pow2_quadratic_hash final
+{
+public:
+    static constexpr bool valid_capacity(unsigned m)
+    {
+        return (m > 0) && ((m & (m - 1)) == 0);
+    }
+
+    static int h(int k, int j, int m)
+    {
+        return int((unsigned(k) + ((unsigned(j)*unsigned(j + 1)) >> 1)) & unsigned(m - 1));
+    }
+};
+
+/*
+ * Linear probing for any m without % per step. Works as long as j < m, which holds
+ * while the table has an empty slot.
+ */
+class Fastrange_linear_hash final
+{
+public:
+    static constexpr bool valid_capacity(unsigned m)
+    {
+        return m > 0;
+    }
+
+    static int h(int k, int j, int m)
+    {
+        const int i = k + j;
+        return (i >= m)? (i - m) : i;
+    }
+};
+
 struct __attribute__ ((aligned (16))) hash_vec
 {
     int i0, i1, i2, i3;
@@ -466,6 +804,165 @@ struct Iter3 final
     }
 };
 
+/*
+ * Incremental quadratic probing: p(j) = (hc + j + j^2) % m, so for L lanes p(j+L) = p(j) + 2Lj + L + L^2
+ * and that increment itself grows by 2L^2. Both stay below m after one conditional subtraction,
+ * so unlike Iter3 there is no % per lane and step. int_holder is packed to 5 bytes, so contents
+ * are gathered from byte offsets 5*p with scale 1.
+ */
+template<unsigned Size>
+struct Iter5_AVX2 final
+{
+    __attribute__((target("avx2")))
+    static int process_search__true__optimized(std::array<int_holder, Size> &table, int_holder &c)
+    {
+        constexpr int lanes = 8;
+        const int m = table.size();
+        const int hc = c.content % m;
+        alignas(32) int pos[lanes];
+        alignas(32) int inc[lanes];
+        for (int j = 0; j < lanes; j++)
+        {
+            pos[j] = (hc + j + j*j)%m;
+            inc[j] = (2*lanes*j + lanes + lanes*lanes)%m;
+        }
+        const void *base = table.data();
+        const __m256i M = _mm256_set1_epi32(m);
+        const __m256i M_1 = _mm256_set1_epi32(m - 1);
+        const __m256i STEP = _mm256_set1_epi32((2*lanes*lanes)%m);
+        const __m256i KEY = _mm256_set1_epi32(c.content);
+        const __m256i ZER = _mm256_setzero_si256();
+        __m256i P = _mm256_load_si256((const __m256i*)pos);
+        __m256i INC = _mm256_load_si256((const __m256i*)inc);
+
+        do
+        {
+            __m256i OFFSETS = _mm256_add_epi32(_mm256_slli_epi32(P, 2), P);
+            __m256i V = _mm256_i32gather_epi32(static_cast<const int*>(base), OFFSETS, 1);
+            // hit or empty (content < 0)
+            __m256i STOP = _mm256_or_si256(_mm256_cmpeq_epi32(V, KEY), _mm256_cmpgt_epi32(ZER, V));
+            int stop = _mm256_movemask_ps(_mm256_castsi256_ps(STOP));
+            if (stop != 0)
+            {
+                _mm256_store_si256((__m256i*)pos, P);
+                return pos[__builtin_ctz(stop)];
+            }
+            P = _mm256_add_epi32(P, INC);
+            P = _mm256_sub_epi32(P, _mm256_and_si256(_mm256_cmpgt_epi32(P, M_1), M));
+            INC = _mm256_add_epi32(INC, STEP);
+            INC = _mm256_sub_epi32(INC, _mm256_and_si256(_mm256_cmpgt_epi32(INC, M_1), M));
+        }  while (true);
+    }
+};
+
+template<unsigned Size>
+struct Iter6_AVX512 final
+{
+    __attribute__((target("avx512f")))
+    static int process_search__true__optimized(std::array<int_holder, Size> &table, int_holder &c)
+    {
+        constexpr int lanes = 16;
+        const int m = table.size();
+        const int hc = c.content % m;
+        alignas(64) int pos[lanes];
+        alignas(64) int inc[lanes];
+        for (int j = 0; j < lanes; j++)
+        {
+            pos[j] = (hc + j + j*j)%m;
+            inc[j] = (2*lanes*j + lanes + lanes*lanes)%m;
+        }
+        const void *base = table.data();
+        const __m512i M = _mm512_set1_epi32(m);
+        const __m512i STEP = _mm512_set1_epi32((2*lanes*lanes)%m);
+        const __m512i KEY = _mm512_set1_epi32(c.content);
+        const __m512i ZER = _mm512_setzero_si512();
+        __m512i P = _mm512_load_si512(pos);
+        __m512i INC = _mm512_load_si512(inc);
+
+        do
+        {
+            // maskz/mask forms, unmasked ones trip gcc -Wuninitialized on _mm512_undefined_epi32
+            __m512i OFFSETS = _mm512_add_epi32(_mm512_maskz_slli_epi32(0xffff, P, 2), P);
+            __m512i V = _mm512_mask_i32gather_epi32(ZER, 0xffff, OFFSETS, base, 1);
+            __mmask16 stop = _mm512_cmpeq_epi32_mask(V, KEY) | _mm512_cmplt_epi32_mask(V, ZER);
+            if (stop != 0)
+            {
+                _mm512_store_si512(pos, P);
+                return pos[__builtin_ctz(stop)];
+            }
+            P = _mm512_add_epi32(P, INC);
+            P = _mm512_mask_sub_epi32(P, _mm512_cmpge_epi32_mask(P, M), P, M);
+            INC = _mm512_add_epi32(INC, STEP);
+            INC = _mm512_mask_sub_epi32(INC, _mm512_cmpge_epi32_mask(INC, M), INC, M);
+        }  while (true);
+    }
+};
+
+enum class probe_kernel
+{
+    sse41, avx2, avx512
+};
+
+static inline probe_kernel selected_probe_kernel()
+{
+    static const probe_kernel kernel = []
+    {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+            return probe_kernel::avx512;
+        if (__builtin_cpu_supports("avx2"))
+            return probe_kernel::avx2;
+        return probe_kernel::sse41;
+    }();
+    return kernel;
+}
+
+static inline const char *probe_kernel_name(probe_kernel kernel)
+{
+    switch (kernel)
+    {
+    case probe_kernel::avx512:
+        return "AVX-512 (16 lanes)";
+    case probe_kernel::avx2:
+        return "AVX2 (8 lanes)";
+    default:
+        return "SSE4.1 (4 lanes)";
+    }
+}
+
+/*
+ * Kernel is picked once, during static initialization, from cpuid so the same binary
+ * uses the widest probe the machine supports.
+ */
+template<unsigned Size>
+struct IterDispatch final
+{
+    using kernel_type = int (*)(std::array<int_holder, Size> &, int_holder &);
+
+    static int process_search__true__optimized(std::array<int_holder, Size> &table, int_holder &c)
+    {
+        return kernel(table, c);
+    }
+
+    static kernel_type select()
+    {
+        switch (selected_probe_kernel())
+        {
+        case probe_kernel::avx512:
+            return &Iter6_AVX512<Size>::process_search__true__optimized;
+        case probe_kernel::avx2:
+            return &Iter5_AVX2<Size>::process_search__true__optimized;
+        default:
+            return &Iter3<Size>::process_search__true__optimized;
+        }
+    }
+
+    static const kernel_type kernel;
+};
+
+template<unsigned Size>
+const typename IterDispatch<Size>::kernel_type IterDispatch<Size>::kernel = IterDispatch<Size>::select();
+
 }
 
 
@@ -235,6 +235,158 @@ static void benchmark__only_hashmap()
     printf("OK :)\n");
 }
 
+template<class Hashmap, class Holder>
+static void benchmark__member(Hashmap &hash_map, const std::vector<int> &inserts, const std::vector<int> &members,
+                              const char *name)
+{
+    Holder basic_config;
+    basic_config.mark = false;
+    hash_map.reset();
+    for (auto item : inserts)
+    {
+        basic_config.content = item;
+        hash_map.insert(basic_config);
+    }
+    hash_map.collisions = 0;
+    unsigned members_hits {0};
+    uint64_t t0 = realtime_now();
+    for (auto item : members)
+    {
+        basic_config.content = item;
+        members_hits += hash_map.member(basic_config);
+    }
+    uint64_t t1 = realtime_now();
+    printf("%s: capacity = %u, alpha = %f, time/member = %f ns, collisions/member = %f, hits = %u\n", name,
+           hash_map.capacity(), hash_map.size()*1.0f/hash_map.capacity(), (t1 - t0)*1.0f/members.size(),
+           hash_map.collisions*1.0f/members.size(), members_hits);
+}
+
+/*
+ * Prime capacity with % on every probe step vs division free power of two mask and fastrange.
+ */
+static void benchmark__division_free()
+{
+    static common::Hashmap<2000003> prime_hashmap;
+    static common::Hashmap<2097152, common::fastrange_int_holder, common::Pow2_quadratic_hash> pow2_hashmap;
+    static common::Hashmap<2000003, common::fastrange_int_holder, common::Fastrange_linear_hash> fastrange_hashmap;
+    static common::Hashmap<2000003, common::int_holder, common::Limited_linear_hash> linear_hashmap;
+
+    constexpr unsigned uniwersum_size {1000000000};
+    constexpr unsigned queries {10000000};
+
+    printf("\n%s\n\n", __FUNCTION__);
+    srand(time(nullptr));
+    for (auto alpha : {0.5f, 0.75f, 0.9f})
+    {
+        std::vector<int> inserts, members;
+        for (unsigned i = 0; i < unsigned(alpha*2000003); i++)
+            inserts.push_back(rand()%uniwersum_size);
+        for (unsigned i = 0; i < queries; i++)
+            members.push_back((i%2 == 0)? inserts[rand()%inserts.size()] : rand()%uniwersum_size);
+
+        benchmark__member<decltype(prime_hashmap), common::int_holder>(prime_hashmap, inserts, members,
+                                                                       "Limited_quadratic_hash (prime, %)");
+        benchmark__member<decltype(pow2_hashmap), common::fastrange_int_holder>(pow2_hashmap, inserts, members,
+                                                                                "Pow2_quadratic_hash (mask)");
+        benchmark__member<decltype(linear_hashmap), common::int_holder>(linear_hashmap, inserts, members,
+                                                                        "Limited_linear_hash (prime, %)");
+        benchmark__member<decltype(fastrange_hashmap), common::fastrange_int_holder>(fastrange_hashmap, inserts, members,
+                                                                                     "Fastrange_linear_hash");
+    }
+}
+
+/*
+ * Structured keys: sequential, strided by 256 (common low bits) and runs of 16 at random bases.
+ * Keys with even index are inserted, members go through all of them so half are misses from the same pattern.
+ */
+static std::vector<int> structured_keys(int pattern, unsigned count)
+{
+    std::vector<int> keys;
+    unsigned base = rand()%1000000;
+    for (unsigned i = 0; i < count; i++)
+    {
+        if (pattern == 0)
+            keys.push_back(int(base + i));
+        else if (pattern == 1)
+            keys.push_back(int(base + 256*i));
+        else
+        {
+            if (i%16 == 0)
+                base = rand()%1000000000;
+            keys.push_back(int(base + i%16));
+        }
+    }
+    return keys;
+}
+
+static void benchmark__hashers()
+{
+    static common::Hashmap<2000003, common::int_holder, common::Limited_linear_hash> linear_hashmap;
+    static common::Hashmap<2000003, common::int_holder, common::Limited_linear_hash, common::Murmur3_hasher> linear_murmur3_hashmap;
+    static common::Hashmap<2000003, common::int_holder, common::Limited_linear_hash, common::Wy_hasher> linear_wy_hashmap;
+    static common::Hashmap<2097152, common::int_holder, common::Pow2_quadratic_hash> pow2_hashmap;
+    static common::Hashmap<2097152, common::int_holder, common::Pow2_quadratic_hash, common::Murmur3_hasher> pow2_murmur3_hashmap;
+    static common::Hashmap<2097152, common::int_holder, common::Pow2_quadratic_hash, common::Wy_hasher> pow2_wy_hashmap;
+    const char *patterns[] = {"sequential", "strided by 256", "clustered, runs of 16"};
+
+    printf("\n%s\n\n", __FUNCTION__);
+    srand(time(nullptr));
+    for (int pattern = 0; pattern < 3; pattern++)
+    {
+        const std::vector<int> members = structured_keys(pattern, 2000000);
+        std::vector<int> inserts;
+        for (unsigned i = 0; i < members.size(); i += 2)
+            inserts.push_back(members[i]);
+
+        printf("keys: %s\n", patterns[pattern]);
+        benchmark__member<decltype(linear_hashmap), common::int_holder>(linear_hashmap, inserts, members,
+                                                                        "Limited_linear_hash + Identity_hasher");
+        benchmark__member<decltype(linear_murmur3_hashmap), common::int_holder>(linear_murmur3_hashmap, inserts, members,
+                                                                                "Limited_linear_hash + Murmur3_hasher");
+        benchmark__member<decltype(linear_wy_hashmap), common::int_holder>(linear_wy_hashmap, inserts, members,
+                                                                           "Limited_linear_hash + Wy_hasher");
+        benchmark__member<decltype(pow2_hashmap), common::int_holder>(pow2_hashmap, inserts, members,
+                                                                      "Pow2_quadratic_hash + Identity_hasher");
+        benchmark__member<decltype(pow2_murmur3_hashmap), common::int_holder>(pow2_murmur3_hashmap, inserts, members,
+                                                                              "Pow2_quadratic_hash + Murmur3_hasher");
+        benchmark__member<decltype(pow2_wy_hashmap), common::int_holder>(pow2_wy_hashmap, inserts, members,
+                                                                         "Pow2_quadratic_hash + Wy_hasher");
+    }
+}
+
+/*
+ * Bloom filter in front of the table pays off with misses, each one costs a filter block instead
+ * of a probe sequence. With hits filter is pure overhead.
+ */
+static void benchmark__bloom_filter()
+{
+    static common::Hashmap<2000003> plain_hashmap;
+    static common::Hashmap<2000003, common::int_holder, common::Limited_quadratic_hash, common::Identity_hasher,
+                           common::Blocked_bloom_filter> filtered_hashmap;
+
+    constexpr unsigned uniwersum_size {1000000000};
+    constexpr unsigned queries {10000000};
+
+    printf("\n%s\n\n", __FUNCTION__);
+    srand(time(nullptr));
+    std::vector<int> inserts;
+    for (unsigned i = 0; i < unsigned(0.75f*2000003); i++)
+        inserts.push_back(rand()%uniwersum_size);
+    for (auto hit_ratio : {0.0f, 0.1f, 0.5f, 0.9f, 1.0f})
+    {
+        std::vector<int> members;
+        for (unsigned i = 0; i < queries; i++)
+            members.push_back((rand()%100 < int(100*hit_ratio))? inserts[rand()%inserts.size()]
+                                                              : rand()%uniwersum_size);
+
+        printf("hit ratio = %.0f%%\n", 100*hit_ratio);
+        benchmark__member<decltype(plain_hashmap), common::int_holder>(plain_hashmap, inserts, members,
+                                                                       "No_filter");
+        benchmark__member<decltype(filtered_hashmap), common::int_holder>(filtered_hashmap, inserts, members,
+                                                                          "Blocked_bloom_filter");
+    }
+}
+
 /*
      * _mm_sra_epi32 - is bad because treats input vector as ints so
       if input = 0xffffffff after shifting by 31 it's still 0xffffffff !
@@ -339,6 +491,26 @@ static void test_intrinsics3()
     printf("%s OK\n", __FUNCTION__);
 }
 
+template<template<unsigned> class Func, class Hashmap>
+static unsigned time_fast_member(Hashmap &hash_map, const std::vector<int> &members, unsigned queries,
+                                 const char *kernel)
+{
+    common::int_holder basic_config;
+    basic_config.mark = false;
+    unsigned members_hits {0};
+
+    uint64_t t0 = realtime_now();
+    for (unsigned i = 0; i < queries; i++)
+    {
+        basic_config.content = members[i%members.size()];
+        members_hits += hash_map.template fast_member<Func>(basic_config);
+    }
+    uint64_t t1 = realtime_now();
+    uint64_t time_ms = (t1 - t0)/1000000;
+    printf("%s kernel: Time = %lu ms, hits = %u.\n", kernel, time_ms, members_hits);
+    return members_hits;
+}
+
 static void benchmark__only_hashmap_basic_for_member()
 {
     static common::ExperimentalHashmap<200003, common::int_holder> hash_map;
@@ -376,6 +548,8 @@ static void benchmark__only_hashmap_basic_for_member()
         members.push_back(rand()%uniwersum_size);
     }
 
+    const auto kernel = common::selected_probe_kernel();
+    printf("Selected probe kernel = %s\n", common::probe_kernel_name(kernel));
     printf("Hashmap start watch\n");
     uint64_t t0 = realtime_now();
     for (unsigned i = 0; i < queries; i++)
@@ -388,6 +562,14 @@ static void benchmark__only_hashmap_basic_for_member()
     uint64_t time_ms = (t1 - t0)/1000000;
     printf("Hashmap stop watch: Time = %lu ms.\n", time_ms);
 
+    time_fast_member<common::Iter3>(hash_map, members, queries, common::probe_kernel_name(common::probe_kernel::sse41));
+    if (kernel != common::probe_kernel::sse41)
+        time_fast_member<common::Iter5_AVX2>(hash_map, members, queries,
+                                             common::probe_kernel_name(common::probe_kernel::avx2));
+    if (kernel == common::probe_kernel::avx512)
+        time_fast_member<common::Iter6_AVX512>(hash_map, members, queries,
+                                               common::probe_kernel_name(common::probe_kernel::avx512));
+
     printf("Summary\n");
     printf("inserts = %d, members = %d, hits = %d, hashmap.size = %d\n",
            inserts_counter, members_counter, members_hits,
@@ -409,5 +591,8 @@ int main()
     benchmarks::test_intrinsics3();
 
     benchmarks::benchmark__only_hashmap_basic_for_member();
+    benchmarks::benchmark__division_free();
+    benchmarks::benchmark__hashers();
+    benchmarks::benchmark__bloom_filter();
     return 0;
 }
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#include <sys/mman.h>
+
+/* Allocation policies for table storage. Big tables are as much TLB bound as cache bound: with 4KB pages
+ * a 100MB table needs 25k dTLB entries, with 2MB pages only 50.
+ * zeroed tells that fresh memory reads as zero bytes, a table whose empty slot is all zero bytes then
+ * skips the initial fill and pages are faulted in on first use only.
+ */
+namespace allocation {
+
+// operator new, cache line aligned
+struct heap {
+    constexpr static bool zeroed = false;
+
+    static void* allocate(std::size_t bytes) {
+        return ::operator new(bytes, std::align_val_t(64));
+    }
+
+    static void deallocate(void *p, std::size_t) noexcept {
+        ::operator delete(p, std::align_val_t(64));
+    }
+};
+
+/* Anonymous mmap aligned to 2MB plus MADV_HUGEPAGE, so transparent huge pages back it
+ * even with THP in madvise mode. Kernel zero-fills pages on first touch.
+ */
+struct huge_pages {
+    constexpr static bool zeroed = true;
+    constexpr static std::size_t huge_page = 2*1024*1024;
+
+    static void* allocate(std::size_t bytes) {
+        const auto size = round_up(bytes);
+        auto raw = mmap(nullptr, size + huge_page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        // trim to 2MB boundary, otherwise first and last huge page may never be collapsed
+        const auto start = reinterpret_cast<uintptr_t>(raw);
+        const auto aligned = (start + huge_page - 1) & ~(huge_page - 1);
+        if (aligned > start) {
+            munmap(raw, aligned - start);
+        }
+        munmap(reinterpret_cast<void*>(aligned + size), start + huge_page - aligned);
+        auto p = reinterpret_cast<void*>(aligned);
+        madvise(p, size, MADV_HUGEPAGE);
+        return p;
+    }
+
+    static void deallocate(void *p, std::size_t bytes) noexcept {
+        munmap(p, round_up(bytes));
+    }
+
+    static std::size_t round_up(std::size_t bytes) noexcept {
+        return (std::max<std::size_t>(bytes, 1) + huge_page - 1) & ~(huge_page - 1);
+    }
+};
+
+/* Explicit MAP_HUGETLB from the reserved pool (vm.nr_hugepages). When the pool is too small
+ * it falls back to huge_pages, fallbacks counts how often that happened.
+ */
+struct hugetlb {
+    constexpr static bool zeroed = true;
+
+    static void* allocate(std::size_t bytes) {
+        auto p = mmap(nullptr, huge_pages::round_up(bytes), PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p == MAP_FAILED) {
+            fallbacks++;
+            return huge_pages::allocate(bytes);
+        }
+        return p;
+    }
+
+    // both kinds of mappings are 2MB multiples
+    static void deallocate(void *p, std::size_t bytes) noexcept {
+        munmap(p, huge_pages::round_up(bytes));
+    }
+
+    static inline unsigned fallbacks = 0;
+};
+
+/* Fixed size owning array of trivially copyable T on top of an allocation policy, filled with `value`
+ * unless the policy gives zeroed memory and value is all zero bytes. Can also be a view of memory
+ * owned by someone else (a mapped snapshot), that is never released.
+ */
+template<class T, class Allocator>
+class array {
+    static_assert(std::is_trivially_copyable_v<T>);
+public:
+    array(std::size_t size, const T &value) : _size(size) {
+        _data = static_cast<T*>(Allocator::allocate(bytes()));
+        if (!(Allocator::zeroed && is_zero(value))) {
+            std::fill_n(_data, _size, value);
+        }
+    }
+
+    array(T *view, std::size_t size) noexcept : _data(view), _size(size), owned(false) {}
+
+    array(const array&) = delete;
+    array& operator=(const array&) = delete;
+
+    array(array &&other) noexcept
+        : _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0)), owned(other.owned) {}
+
+    array& operator=(array &&other) noexcept {
+        std::swap(_data, other._data);
+        std::swap(_size, other._size);
+        std::swap(owned, other.owned);
+        return *this;
+    }
+
+    ~array() {
+        if (_data && owned) {
+            Allocator::deallocate(_data, bytes());
+        }
+    }
+
+    T& operator[](std::size_t i) noexcept {
+        return _data[i];
+    }
+
+    const T& operator[](std::size_t i) const noexcept {
+        return _data[i];
+    }
+
+    std::size_t size() const noexcept {
+        return _size;
+    }
+
+    T* begin() noexcept {
+        return _data;
+    }
+
+    T* end() noexcept {
+        return _data + _size;
+    }
+
+    const T* begin() const noexcept {
+        return _data;
+    }
+
+    const T* end() const noexcept {
+        return _data + _size;
+    }
+
+    static bool is_zero(const T &value) noexcept {
+        T zero;
+        std::memset(static_cast<void*>(&zero), 0, sizeof(T));
+        return std::memcmp(static_cast<const void*>(&zero), static_cast<const void*>(&value), sizeof(T)) == 0;
+    }
+
+private:
+    std::size_t bytes() const noexcept {
+        return _size*sizeof(T);
+    }
+
+    T *_data = nullptr;
+    std::size_t _size;
+    bool owned = true;
+};
+
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <immintrin.h>
+#include "hashers.hh"
+
+/* Front-end filters for tables with many misses. A table asks may_contain() before probing,
+ * false means the key is surely absent and the table is not touched at all.
+ */
+namespace bloom {
+
+// no filter, every key may be present
+struct none {
+    explicit none(unsigned) noexcept {}
+
+    void insert(uint64_t) noexcept {}
+
+    bool may_contain(uint64_t) const noexcept {
+        return true;
+    }
+
+    void clear() noexcept {}
+};
+
+/* Blocked Bloom filter: a key maps to one 64-byte block (16 x 32-bit words) and sets one bit in each
+ * word, bit i from the key hash times salt i. A lookup is one cache line and, with AVX2, two
+ * 8-lane multiply/shift/test steps. No deletion - tables rebuild it when they drop tombstones.
+ * With 16 bits per key false positive rate is ~0.2%.
+ */
+class blocked {
+public:
+    explicit blocked(unsigned keys, unsigned bits_per_key = 16)
+        : blocks(std::max<uint64_t>(1, (uint64_t(keys)*bits_per_key + block_bits - 1)/block_bits)) {}
+
+    void insert(uint64_t key) noexcept {
+        const auto hash = hashers::murmur3::hash(key);
+        auto &b = blocks[index(hash)];
+        for (auto i = 0u; i < words; i++) {
+            b.word[i] |= bit(uint32_t(hash), i);
+        }
+    }
+
+    bool may_contain(uint64_t key) const noexcept {
+        const auto hash = hashers::murmur3::hash(key);
+        const auto &b = blocks[index(hash)];
+#ifdef __AVX2__
+        const auto h = _mm256_set1_epi32(int(uint32_t(hash)));
+        const auto one = _mm256_set1_epi32(1);
+        for (auto i = 0u; i < words; i += 8) {
+            auto salt = _mm256_load_si256(reinterpret_cast<const __m256i*>(salts + i));
+            auto mask = _mm256_sllv_epi32(one, _mm256_srli_epi32(_mm256_mullo_epi32(h, salt), 27));
+            // (~block & mask) == 0, all bits of the key are set
+            if (!_mm256_testc_si256(_mm256_load_si256(reinterpret_cast<const __m256i*>(b.word + i)), mask)) {
+                return false;
+            }
+        }
+        return true;
+#else
+        for (auto i = 0u; i < words; i++) {
+            const auto mask = bit(uint32_t(hash), i);
+            if ((b.word[i] & mask) != mask) {
+                return false;
+            }
+        }
+        return true;
+#endif
+    }
+
+    void clear() noexcept {
+        std::fill(blocks.begin(), blocks.end(), block{});
+    }
+
+    unsigned size_in_bytes() const noexcept {
+        return unsigned(blocks.size()*sizeof(block));
+    }
+
+private:
+    constexpr static unsigned words = 16;
+    constexpr static unsigned block_bits = 32*words;
+
+    struct alignas(64) block {
+        uint32_t word[words] = {};
+    };
+
+    alignas(32) constexpr static uint32_t salts[words] = {
+        0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du, 0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u,
+        0x9e3779b1u, 0x85ebca77u, 0xc2b2ae3du, 0x27d4eb2fu, 0x165667b1u, 0xd3a2646du, 0xfd7046c5u, 0xb55a4f09u
+    };
+
+    // block from the high half, bits from the low half of the hash
+    unsigned index(uint64_t hash) const noexcept {
+        return unsigned(((hash >> 32)*blocks.size()) >> 32);
+    }
+
+    static uint32_t bit(uint32_t hash, unsigned i) noexcept {
+        return uint32_t(1) << ((hash*salts[i]) >> 27);
+    }
+
+    std::vector<block> blocks;
+};
+
+}
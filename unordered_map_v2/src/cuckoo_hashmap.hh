@@ -6,81 +6,131 @@
 #include <cassert>
 #include <tuple>
 #include <vector>
+#include <span>
+#include <algorithm>
+#include <utility>
+#include <cstring>
 #include <iostream>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <string>
+#include <immintrin.h>
+#include "fast_mod.hh"
+#include "hashers.hh"
+#include "allocation.hh"
+#include "snapshot.hh"
 
 namespace cuckoo {
 
-template<class T = int>
+template<class T, class Hasher>
+class concurrent_set;
+
+// how insert makes room when both candidate locations are taken
+struct random_walk {};  // kick out slot[i%4] and its right slot in turn, at most loop_limit times
+struct bfs_path {};     // shortest eviction path found first by BFS, keys move only once it reaches a free slot
+
+/* Both tables are arrays of Slots-way buckets (4 or 8), a bucket is aligned to its size so it never spans
+ * two cache lines. A key lives in one of the slots of its left or its right bucket: lookup prefetches both
+ * buckets and compares each one against the key with a single SIMD compare + movemask. With BFS eviction
+ * 4-way buckets on both sides hold ~95% load before a rehash.
+ * Left and right bucket come from two independently seeded multiply-shift functions on top of Hasher,
+ * so the two choices of a key are not correlated.
+ * A key that finds no room goes to a stash of up to Stash keys, checked only when it is not empty.
+ * Once the stash is full, below max_reseed_alpha the tables are rebuilt at the same capacity with
+ * new seeds (at most max_reseeds times per capacity), above it they grow.
+ * Rehash is incremental: when an insert finds no room, current tables become the old ones and every
+ * following insert/erase moves rehash_step_size old buckets into the new, twice bigger tables. Until the
+ * old tables are drained lookups check both. Only if a key doesn't fit while that is in progress everything
+ * is rebuilt at once into bigger tables, still without a side copy of the keys.
+ * Allocator backs bucket arrays, see allocation.hh. Empty slot is not zero, so buckets are always filled.
+ * save() writes both tables, the seeds and the stash to a snapshot file, load() maps it back in place.
+ */
+template<class T = int, class Hasher = hashers::identity, class Eviction = bfs_path, unsigned Slots = 4, unsigned Stash = 8,
+         class Allocator = allocation::heap>
 class set {
     static_assert(std::is_fundamental_v<T>);
+    static_assert(std::is_same_v<Eviction, random_walk> || std::is_same_v<Eviction, bfs_path>);
+    static_assert(Slots == 4 || Slots == 8);
+    static_assert(Stash <= 16);
 public:
+    using key_type = T;
+    constexpr static unsigned slots_per_bucket = Slots;
+
+    // capacities are numbers of buckets in left and right table
     set(unsigned left, unsigned right)
-        : n(0), left_capacity(left), right_capacity(right),
-          table_left(left_capacity, {infinity, infinity, infinity, infinity}),
-          table_right(right_capacity, infinity),
-          loop_limit(log2(right_capacity)),
+        : n(0), table(left, right, seed_state),
+          loop_limit(log2(right)),
           rehash_counter(0)
     {
         // best speed when capacities are primes
-        assert(right_capacity > left_capacity && right_capacity - left_capacity < 50);
+        assert(right > left && right - left < 50);
     }
 
     set(const set&) = delete;
     set& operator=(const set&) = delete;
 
     void insert(T item) {
+       migrate(rehash_step_size);
        if (search(item)) {
            return;
        }
-
-       for (auto i = 0u; i < loop_limit; i++) {
-           auto left = h_left(item, left_capacity);
-           if (table_left[left].slot[0] == infinity) {
-               table_left[left].slot[0] = item;
-               return;
-           } else if (table_left[left].slot[1] == infinity) {
-               table_left[left].slot[1] = item;
-               return;
-           } else if (table_left[left].slot[2] == infinity) {
-               table_left[left].slot[2] = item;
-               return;
-           }  else if (table_left[left].slot[3] == infinity) {
-               table_left[left].slot[3] = item;
-               return;
-           }
-           std::swap(item, table_left[left].slot[i%4]);
-
-           std::swap(item, table_right[h_right(item, right_capacity)]);
-           if (item == infinity) {
-               return;
+       n++;
+       if (!place(table, item)) {
+           cycles++;
+           if (!to_stash(item)) {
+               grow(item);
            }
        }
-       rehash(item);
     }
 
     bool search(T item) const noexcept {
-       auto left = h_left(item, left_capacity);
-       return table_left[left].slot[0] == item || table_left[left].slot[1] == item || table_left[left].slot[2] == item || table_left[left].slot[3] == item
-               || table_right[h_right(item, right_capacity)] == item;
+       return table.contains(item) || (stashed != 0 && in_stash(item) >= 0) || (old_table && old_table->contains(item));
     }
 
-    void erase(T item) noexcept {
-        auto left = h_left(item, left_capacity);
-        if (table_left[left].slot[0] == item) {
-            table_left[left].slot[0] = infinity;
-        } else if (table_left[left].slot[1] == item) {
-            table_left[left].slot[1] = infinity;
-        } else if (table_left[left].slot[2] == item) {
-            table_left[left].slot[2] = infinity;
-        } else if (table_left[left].slot[3] == item) {
-            table_left[left].slot[3] = infinity;
+    // both candidate buckets of up to `group` keys are prefetched before any of them is compared
+    unsigned search_many(std::span<const T> items, std::span<bool> found, unsigned group = 16) const noexcept {
+        assert(found.size() >= items.size() && group > 0 && group <= max_prefetch_group);
+        auto hits = 0u;
+        if (old_table || stashed != 0) {
+            for (auto k = 0u; k < items.size(); k++) {
+                found[k] = search(items[k]);
+                hits += found[k];
+            }
+            return hits;
+        }
+        T lefts[max_prefetch_group], rights[max_prefetch_group];
+        for (auto first = 0u; first < items.size(); first += group) {
+            const auto last = std::min<std::size_t>(first + group, items.size());
+            for (auto k = first; k < last; k++) {
+                lefts[k - first] = table.h_left(items[k]);
+                rights[k - first] = table.h_right(items[k]);
+                __builtin_prefetch(&table.left[lefts[k - first]]);
+                __builtin_prefetch(&table.right[rights[k - first]]);
+            }
+            for (auto k = first; k < last; k++) {
+                found[k] = match(table.left[lefts[k - first]], items[k]) != 0 || match(table.right[rights[k - first]], items[k]) != 0;
+                hits += found[k];
+            }
         }
-        else
-        {
-            auto right = h_right(item, right_capacity);
-            if (table_right[right] == item) {
-                table_right[right] = infinity;
+        return hits;
+    }
+
+    void erase(T item) {
+        migrate(rehash_step_size);
+        if (table.erase(item)) {
+            n--;
+            // there is a free slot now, may be in reach of the last stashed key
+            if (stashed != 0 && place(table, stash[stashed - 1])) {
+                stashed--;
             }
+        } else if (auto i = in_stash(item); i >= 0) {
+            stash[i] = stash[--stashed];
+            n--;
+        } else if (old_table && old_table->erase(item)) {
+            n--;
         }
     }
 
@@ -89,81 +139,955 @@ public:
     }
 
     std::tuple<unsigned, unsigned> capacities() const noexcept {
-        return {left_capacity, right_capacity};
+        return {table.left_capacity, table.right_capacity};
+    }
+
+    unsigned stash_size() const noexcept {
+        return stashed;
+    }
+
+    // migration in progress is finished first
+    void save(const std::string &file_name) {
+        if (old_table) {
+            migrate(unsigned(old_table->left.size() + old_table->right.size()));
+        }
+        snapshot::header head = {};
+        head.slot_size = sizeof(bucket);
+        head.layout = layout();
+        head.count = n;
+        head.capacity[0] = table.left_capacity;
+        head.capacity[1] = table.right_capacity;
+        head.seed[0] = seed_state;
+        head.seed[1] = table.left_hash.a;
+        head.seed[2] = table.left_hash.b;
+        head.seed[3] = table.right_hash.a;
+        head.seed[4] = table.right_hash.b;
+        head.stashed = stashed;
+        for (auto i = 0u; i < stashed; i++) {
+            head.stash[i] = uint64_t(stash[i]);
+        }
+        snapshot::write(file_name, head, std::as_bytes(std::span<const bucket>(table.left.begin(), table.left.size())),
+                        std::as_bytes(std::span<const bucket>(table.right.begin(), table.right.size())));
+    }
+
+    // lookups only with mode::read_only, mode::copy_on_write allows changes
+    static set load(const std::string &file_name, snapshot::mode m = snapshot::mode::read_only) {
+        return set(std::make_unique<snapshot::file>(file_name, m, sizeof(bucket), layout(), 2, Slots, Stash));
     }
 
 private:
+    friend class concurrent_set<T, Hasher>;
+
+    explicit set(std::unique_ptr<snapshot::file> file)
+        : n(unsigned(file->head().count)), table(*file),
+          loop_limit(log2(file->head().capacity[1])),
+          rehash_counter(0)
+    {
+        seed_state = file->head().seed[0];
+        stashed = file->head().stashed;
+        for (auto i = 0u; i < stashed; i++) {
+            stash[i] = T(file->head().stash[i]);
+        }
+        mapped = std::move(file);
+    }
+
+    static uint64_t layout() noexcept {
+        return snapshot::layout<T, Hasher, std::integral_constant<unsigned, Slots>, std::integral_constant<unsigned, Stash>>();
+    }
+
+    struct alignas(Slots*sizeof(T)) bucket {
+        T slot[Slots];
+    };
+
+    static bucket empty_bucket() noexcept {
+        bucket result;
+        std::fill_n(result.slot, Slots, infinity);
+        return result;
+    }
+
+    // bit i set when slot[i] == item
+    static unsigned match(const bucket &b, T item) noexcept {
+        if constexpr (std::is_integral_v<T> && sizeof(T) == sizeof(int32_t)) {
+#ifdef __AVX2__
+            if constexpr (Slots == 8) {
+                auto slots = _mm256_load_si256(reinterpret_cast<const __m256i*>(b.slot));
+                return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(slots, _mm256_set1_epi32(int32_t(item)))));
+            }
+#endif
+            auto key = _mm_set1_epi32(int32_t(item));
+            auto result = 0u;
+            for (auto i = 0u; i < Slots; i += 4) {
+                auto slots = _mm_load_si128(reinterpret_cast<const __m128i*>(b.slot + i));
+                result |= unsigned(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(slots, key)))) << i;
+            }
+            return result;
+        }
+#ifdef __SSE4_1__
+        if constexpr (std::is_integral_v<T> && sizeof(T) == sizeof(int64_t)) {
+#ifdef __AVX2__
+            auto key = _mm256_set1_epi64x(int64_t(item));
+            auto result = 0u;
+            for (auto i = 0u; i < Slots; i += 4) {
+                auto slots = _mm256_load_si256(reinterpret_cast<const __m256i*>(b.slot + i));
+                result |= unsigned(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(slots, key)))) << i;
+            }
+            return result;
+#else
+            auto key = _mm_set1_epi64x(int64_t(item));
+            auto result = 0u;
+            for (auto i = 0u; i < Slots; i += 2) {
+                auto slots = _mm_load_si128(reinterpret_cast<const __m128i*>(b.slot + i));
+                result |= unsigned(_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(slots, key)))) << i;
+            }
+            return result;
+#endif
+        }
+#endif
+        auto result = 0u;
+        for (auto i = 0u; i < Slots; i++) {
+            result |= unsigned(b.slot[i] == item) << i;
+        }
+        return result;
+    }
+
+    static T reduce(uint64_t hash, const fast_mod &m) noexcept {
+        if constexpr (sizeof(T) <= sizeof(uint32_t)) {
+            return m(uint32_t(hash));
+        } else {
+            return hash % m.divisor;
+        }
+    }
+
+    struct tables {
+        // seeds of both sides are drawn from seed_state
+        tables(unsigned left_size, unsigned right_size, uint64_t &seed_state)
+            : left_capacity(left_size), right_capacity(right_size), left_mod(left_size), right_mod(right_size),
+              left_hash(seed_state), right_hash(seed_state),
+              left(left_size, empty_bucket()), right(right_size, empty_bucket()) {}
+
+        // views of the mapped snapshot sections
+        explicit tables(const snapshot::file &file)
+            : left_capacity(unsigned(file.head().capacity[0])), right_capacity(unsigned(file.head().capacity[1])),
+              left_mod(left_capacity), right_mod(right_capacity),
+              left(file.section<bucket>(0), left_capacity), right(file.section<bucket>(1), right_capacity) {
+            left_hash.a = file.head().seed[1];
+            left_hash.b = file.head().seed[2];
+            right_hash.a = file.head().seed[3];
+            right_hash.b = file.head().seed[4];
+        }
+
+        T h_left(T x) const noexcept {
+            return reduce(left_hash(Hasher::hash(uint64_t(x))), left_mod);
+        }
+
+        T h_right(T x) const noexcept {
+            return reduce(right_hash(Hasher::hash(uint64_t(x))), right_mod);
+        }
+
+        bool contains(T item) const noexcept {
+            const auto &l = left[h_left(item)];
+            const auto &r = right[h_right(item)];
+            __builtin_prefetch(&r);
+            return match(l, item) != 0 || match(r, item) != 0;
+        }
+
+        bool erase(T item) noexcept {
+            for (auto b : {&left[h_left(item)], &right[h_right(item)]}) {
+                if (auto hit = match(*b, item)) {
+                    b->slot[__builtin_ctz(hit)] = infinity;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        unsigned left_capacity, right_capacity;
+        fast_mod left_mod, right_mod;
+        hashers::multiply_shift left_hash, right_hash;
+        allocation::array<bucket, Allocator> left;
+        allocation::array<bucket, Allocator> right;
+    };
+
+    int in_stash(T item) const noexcept {
+        for (auto i = 0u; i < stashed; i++) {
+            if (stash[i] == item) {
+                return int(i);
+            }
+        }
+        return -1;
+    }
+
+    bool to_stash(T item) noexcept {
+        if (Stash == 0 || stashed == Stash) {
+            return false;
+        }
+        stash[stashed++] = item;
+        return true;
+    }
+
+    // after a resize stashed keys have a good chance to fit
+    void unstash() {
+        for (auto i = 0u; i < stashed;) {
+            if (place(table, stash[i])) {
+                stash[i] = stash[--stashed];
+            } else {
+                i++;
+            }
+        }
+    }
+
+    // location visited by BFS, slot k of a table is bucket k/Slots slot k%Slots, parent < 0 for candidates of the inserted key
+    struct node {
+        bool is_left;
+        unsigned index;
+        int parent;
+    };
 
-    static T h_left(T x, unsigned m) noexcept {
-        return x % m;
+    static T& at(tables &t, const node &position) noexcept {
+        auto &buckets = position.is_left? t.left : t.right;
+        return buckets[position.index/Slots].slot[position.index%Slots];
     }
 
-    static T h_right(T x, unsigned m) noexcept {
-        return x % m;
+    /* Puts item into t. On failure t holds the same keys, except that with random walk
+     * item is swapped for the key kicked out last, the one still homeless.
+     */
+    bool place(tables &t, T &item) {
+        if constexpr (std::is_same_v<Eviction, bfs_path>) {
+            return place_along_path(t, item);
+        }
+        for (auto i = 0u; i < loop_limit; i++) {
+            auto &left = t.left[t.h_left(item)];
+            if (auto free = match(left, infinity)) {
+                left.slot[__builtin_ctz(free)] = item;
+                return true;
+            }
+            std::swap(item, left.slot[i%Slots]);
+
+            auto &right = t.right[t.h_right(item)];
+            if (auto free = match(right, infinity)) {
+                right.slot[__builtin_ctz(free)] = item;
+                return true;
+            }
+            std::swap(item, right.slot[i%Slots]);
+        }
+        return false;
     }
 
-    void rehash(T x) {
-        rehash_counter++;
-        std::vector temporary_storage = {x};
-        // use ranges
-        for (auto &item : table_left) {
-            if (item.slot[0] != infinity)
-                temporary_storage.push_back(item.slot[0]);
-            if (item.slot[1] != infinity)
-                temporary_storage.push_back(item.slot[1]);
-            if (item.slot[2] != infinity)
-                temporary_storage.push_back(item.slot[2]);
-            if (item.slot[3] != infinity)
-                temporary_storage.push_back(item.slot[3]);
+    bool place_along_path(tables &t, T item) {
+        const auto left = unsigned(t.h_left(item)), right = unsigned(t.h_right(item));
+        for (auto candidate : {&t.left[left], &t.right[right]}) {
+            if (auto free = match(*candidate, infinity)) {
+                candidate->slot[__builtin_ctz(free)] = item;
+                return true;
+            }
         }
-        for (auto &item : table_right) {
-            if (item != infinity)
-                temporary_storage.push_back(item);
+        path.clear();
+        for (auto i = 0u; i < Slots; i++) {
+            path.push_back({true, Slots*left + i, -1});
         }
-        left_capacity = prime(2*left_capacity);
-        right_capacity = prime(left_capacity);
-        loop_limit++;
-        if (left_capacity > table_left.size()) {
-            table_left.resize(left_capacity);
+        for (auto i = 0u; i < Slots; i++) {
+            path.push_back({false, Slots*right + i, -1});
         }
-        if (right_capacity > table_right.size()) {
-            table_right.resize(right_capacity);
+        // keys of visited locations are expanded in BFS order, so the first bucket with a free slot ends a shortest path
+        for (auto k = 0u; k < path.size() && path.size() < max_path_nodes; k++) {
+            const auto from = path[k];
+            const auto key = at(t, from);
+            const auto to = from.is_left? t.h_right(key) : t.h_left(key);
+            const auto &target = (from.is_left? t.right : t.left)[to];
+            if (auto free = match(target, infinity)) {
+                path.push_back({!from.is_left, Slots*unsigned(to) + __builtin_ctz(free), int(k)});
+                at(t, path[move_along(t, int(path.size()) - 1)]) = item;
+                return true;
+            }
+            for (auto i = 0u; i < Slots; i++) {
+                path.push_back({!from.is_left, Slots*unsigned(to) + i, int(k)});
+            }
+        }
+        return false;
+    }
+
+    // path[last] is free, every key on the way to it moves one step, from the free end; returns the freed root
+    int move_along(tables &t, int last) noexcept {
+        auto k = last;
+        for (; path[k].parent >= 0; k = path[k].parent) {
+            at(t, path[k]) = at(t, path[path[k].parent]);
+        }
+        return k;
+    }
+
+    /* Current tables become the old ones, homeless is the key which didn't fit. A failure well below
+     * the load the tables can hold means a cycle of unlucky keys, new seeds at the same capacity break it.
+     */
+    void grow(T homeless) {
+        if (old_table) {
+            rebuild(homeless);
+            return;
+        }
+        auto left = table.left_capacity, right = table.right_capacity;
+        if (n < max_reseed_alpha*Slots*(left + right) && reseeds_in_row < max_reseeds) {
+            reseed_counter++;
+            reseeds_in_row++;
+        } else {
+            rehash_counter++;
+            reseeds_in_row = 0;
+            loop_limit++;
+            left = prime(2*left);
+            right = prime(left);
+        }
+        old_table = std::make_unique<tables>(std::move(table));
+        table = tables(left, right, seed_state);
+        rehash_index = 0;
+        if (!place(table, homeless)) {
+            rebuild(homeless);
+            return;
+        }
+        unstash();
+    }
+
+    // moves keys of at most `steps` old buckets, left ones first
+    void migrate(unsigned steps) {
+        if (!old_table) {
+            return;
+        }
+        const auto left_size = unsigned(old_table->left.size());
+        const auto old_buckets = left_size + unsigned(old_table->right.size());
+        const auto last = std::min(rehash_index + steps, old_buckets);
+        for (; rehash_index < last; rehash_index++) {
+            auto &b = (rehash_index < left_size)? old_table->left[rehash_index] : old_table->right[rehash_index - left_size];
+            for (auto i = 0u; i < Slots; i++) {
+                auto item = b.slot[i];
+                if (item != infinity) {
+                    b.slot[i] = infinity;
+                    if (!place(table, item)) {
+                        cycles++;
+                        if (!to_stash(item)) {
+                            rebuild(item);
+                            return;
+                        }
+                    }
+                }
+            }
+        }
+        if (rehash_index == old_buckets) {
+            old_table.reset();
+        }
+    }
+
+    /* Fallback when a key doesn't fit while old tables are still being drained and the stash is full:
+     * keys of both generations, the stash and homeless go at once to tables twice bigger than current,
+     * those are dropped and doubled again until everything fits.
+     */
+    void rebuild(T homeless) {
+        auto left = table.left_capacity;
+        for (;;) {
+            rehash_counter++;
+            loop_limit++;
+            left = prime(2*left);
+            tables bigger(left, prime(left), seed_state);
+            auto item = homeless;
+            auto stash_fits = [&] {
+                for (auto i = 0u; i < stashed; i++) {
+                    auto stashed_item = stash[i];
+                    if (!place(bigger, stashed_item)) {
+                        return false;
+                    }
+                }
+                return true;
+            };
+            if (copy(table, bigger) && (!old_table || copy(*old_table, bigger)) && stash_fits() && place(bigger, item)) {
+                table = std::move(bigger);
+                old_table.reset();
+                stashed = 0;
+                return;
+            }
         }
-        std::fill(table_left.begin(), table_left.begin() + left_capacity, bucket{infinity, infinity, infinity, infinity});
-        std::fill(table_right.begin(), table_right.begin() + right_capacity, infinity);
-        for (auto &item : temporary_storage) {
-            insert(item);
+    }
+
+    bool copy(const tables &from, tables &to) {
+        for (auto buckets : {&from.left, &from.right}) {
+            for (auto &b : *buckets) {
+                for (auto i = 0u; i < Slots; i++) {
+                    auto item = b.slot[i];
+                    if (item != infinity && !place(to, item)) {
+                        return false;
+                    }
+                }
+            }
         }
+        return true;
     }
 
     unsigned n;
-    unsigned left_capacity, right_capacity;
-    struct bucket {
-        T slot[4];
-    } __attribute__((packed));
-
-    std::vector<bucket> table_left;
-    std::vector<T> table_right;
-    constexpr static auto infinity = std::numeric_limits<int>::min();
+    uint64_t seed_state = initial_seed;
+    tables table;
+    std::unique_ptr<tables> old_table;
+    // old buckets before it are already moved, left ones are numbered first
+    unsigned rehash_index = 0;
+    T stash[std::max(Stash, 1u)];
+    unsigned stashed = 0;
+
+    constexpr static T infinity = std::numeric_limits<int>::min();
+    constexpr static unsigned max_prefetch_group = 64;
+    // fixed, runs are repeatable
+    constexpr static uint64_t initial_seed = UINT64_C(0x2545f4914f6cdd1d);
+    // 4-way buckets with BFS fill up to ~0.95, a failure below that is bad luck rather than a full table
+    constexpr static float max_reseed_alpha = 0.85f;
+    constexpr static unsigned max_reseeds = 2;
+    // since the last growth
+    unsigned reseeds_in_row = 0;
+    // old buckets moved per insert/erase, old tables are drained well before the new ones fill up
+    constexpr static unsigned rehash_step_size = 4;
+    // bounds BFS, 4-5 levels of 4-way buckets
+    constexpr static unsigned max_path_nodes = 2048;
     unsigned loop_limit;
+    // BFS nodes, reused between inserts
+    std::vector<node> path;
+    std::unique_ptr<snapshot::file> mapped;
+public:
+    unsigned rehash_counter;
+    // insertions that found no room in the tables (stashed or not) and tables rebuilt with new seeds
+    unsigned cycles = 0;
+    unsigned reseed_counter = 0;
+};
+
+/* Concurrent cuckoo set. It deliberately keeps the layout set had before its buckets went N-slot SIMD on
+ * both sides: 4-slot left buckets and a 1-slot right table, compared slot by slot. Slots are atomics and
+ * a vector load over them is not a set of atomic loads, so set's match() doesn't carry over.
+ * Every left bucket and right slot maps to one of the stripes - a seqlock version, odd while a writer
+ * holds it. Readers take no lock: they read both versions, the two candidate locations and validate
+ * the versions afterwards, retrying if a writer was inside. Writers lock only the stripes of the two
+ * locations they touch. When both candidates are full, the displacement path is found by BFS without
+ * locks and then executed from its free end, one move at a time under the stripes of that move's
+ * source and destination; a move that finds its source or destination changed restarts the insert.
+ * Resize blocks writers (shared/exclusive resize lock) but not readers, which keep reading the old
+ * tables until the new ones are published. Retired tables are freed with the set, as capacity
+ * doubles (or stays after a reseed, at most max_reseeds times) they take little more than the live ones.
+ */
+template<class T = int, class Hasher = hashers::identity>
+class concurrent_set {
+    static_assert(std::is_integral_v<T> && std::atomic<T>::is_always_lock_free);
 public:
-    static unsigned prime(unsigned from) noexcept {
+    concurrent_set(const concurrent_set&) = delete;
+    concurrent_set& operator=(const concurrent_set&) = delete;
+
+    using key_type = T;
+    concurrent_set(unsigned left, unsigned right)
+        : current(new tables(left, right, seed_state)) {
+        // best speed when capacities are primes
+        assert(right > left);
+        retired.emplace_back(current.load(std::memory_order_relaxed));
+    }
+
+    void insert(T item) {
+        assert(item != empty);
         for (;;) {
-            from++;
-            auto last = unsigned(sqrt(from)) + 1u;
-            auto i = 2u;
-            for (; i <= last; i++)
-                if (from % i == 0) {
+            std::shared_lock writers(resize_lock);
+            auto &t = *current.load(std::memory_order_acquire);
+            const auto l = t.h_left(item), r = t.h_right(item);
+            {
+                stripes_guard guard(*this, left_stripe(l), right_stripe(r));
+                if (contains(t, l, r, item)) {
+                    return;
+                }
+                if (auto slot = free_slot(t, l, r)) {
+                    slot->store(item, std::memory_order_relaxed);
+                    n.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+            // reused between inserts of the same thread
+            thread_local std::vector<node> path;
+            node end;
+            const auto last = find_path(t, l, r, path, end);
+            if (last == no_path) {
+                writers.unlock();
+                resize(&t);
+            } else {
+                // fails only when another writer got in between, then just try again
+                move_along(t, path, last, end);
+            }
+        }
+    }
+
+    void erase(T item) {
+        std::shared_lock writers(resize_lock);
+        auto &t = *current.load(std::memory_order_acquire);
+        const auto l = t.h_left(item), r = t.h_right(item);
+        stripes_guard guard(*this, left_stripe(l), right_stripe(r));
+        for (auto i = 0u; i < 4; i++) {
+            if (t.left[4*l + i].load(std::memory_order_relaxed) == item) {
+                t.left[4*l + i].store(empty, std::memory_order_relaxed);
+                n.fetch_sub(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+        if (t.right[r].load(std::memory_order_relaxed) == item) {
+            t.right[r].store(empty, std::memory_order_relaxed);
+            n.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    bool search(T item) const noexcept {
+        for (auto spins = 0u;; spins++) {
+            auto &t = *current.load(std::memory_order_acquire);
+            const auto l = t.h_left(item), r = t.h_right(item);
+            const auto &left_version = versions[left_stripe(l)].value, &right_version = versions[right_stripe(r)].value;
+            const auto v1 = left_version.load(std::memory_order_acquire);
+            const auto v2 = right_version.load(std::memory_order_acquire);
+            if ((v1 | v2) & 1) {
+                backoff(spins);
+                continue;
+            }
+            const auto found = contains(t, l, r, item);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (left_version.load(std::memory_order_relaxed) == v1 && right_version.load(std::memory_order_relaxed) == v2) {
+                return found;
+            }
+        }
+    }
+
+    unsigned size() const noexcept {
+        return n.load(std::memory_order_relaxed);
+    }
+
+    std::tuple<unsigned, unsigned> capacities() const noexcept {
+        auto &t = *current.load(std::memory_order_acquire);
+        return {t.left_capacity, t.right_capacity};
+    }
+
+    std::atomic<unsigned> rehash_counter = 0;
+    std::atomic<unsigned> reseed_counter = 0;
+private:
+    struct tables {
+        tables(unsigned left_size, unsigned right_size, uint64_t &seed_state)
+            : left_capacity(left_size), right_capacity(right_size), left_mod(left_size), right_mod(right_size),
+              left_hash(seed_state), right_hash(seed_state),
+              left(new std::atomic<T>[4*left_size]), right(new std::atomic<T>[right_size]) {
+            for (auto i = 0u; i < 4*left_capacity; i++) {
+                left[i].store(empty, std::memory_order_relaxed);
+            }
+            for (auto i = 0u; i < right_capacity; i++) {
+                right[i].store(empty, std::memory_order_relaxed);
+            }
+        }
+
+        unsigned h_left(T x) const noexcept {
+            return set<T, Hasher>::reduce(left_hash(Hasher::hash(uint64_t(x))), left_mod);
+        }
+
+        unsigned h_right(T x) const noexcept {
+            return set<T, Hasher>::reduce(right_hash(Hasher::hash(uint64_t(x))), right_mod);
+        }
+
+        const unsigned left_capacity, right_capacity;
+        const fast_mod left_mod, right_mod;
+        const hashers::multiply_shift left_hash, right_hash;
+        // bucket l is left[4*l .. 4*l + 3]
+        const std::unique_ptr<std::atomic<T>[]> left;
+        const std::unique_ptr<std::atomic<T>[]> right;
+    };
+
+    struct alignas(64) version {
+        std::atomic<unsigned> value = 0;
+    };
+
+    // position of a key met by BFS, parent < 0 for the two candidate locations of the inserted key
+    struct node {
+        bool is_left;
+        unsigned index;
+        T key;
+        int parent;
+    };
+
+    // locks (seqlock write side) one or two stripes in increasing order, so writers can't deadlock
+    class stripes_guard {
+    public:
+        stripes_guard(const concurrent_set &owner, unsigned a, unsigned b)
+            : versions(owner.versions), first(std::min(a, b)), second(std::max(a, b)) {
+            lock(first);
+            if (second != first) {
+                lock(second);
+            }
+        }
+
+        ~stripes_guard() {
+            if (second != first) {
+                unlock(second);
+            }
+            unlock(first);
+        }
+
+        stripes_guard(const stripes_guard&) = delete;
+        stripes_guard& operator=(const stripes_guard&) = delete;
+    private:
+        void lock(unsigned stripe) {
+            auto &value = versions[stripe].value;
+            for (auto spins = 0u;; spins++) {
+                auto v = value.load(std::memory_order_relaxed);
+                if ((v & 1) == 0 && value.compare_exchange_weak(v, v + 1, std::memory_order_acquire)) {
                     break;
                 }
-            if (i == last + 1) {
-                break;
+                backoff(spins);
+            }
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+
+        void unlock(unsigned stripe) {
+            versions[stripe].value.fetch_add(1, std::memory_order_release);
+        }
+
+        version *versions;
+        unsigned first, second;
+    };
+
+    constexpr static T empty = std::numeric_limits<T>::min();
+    constexpr static unsigned stripes = 1024;
+    constexpr static unsigned max_path_nodes = 512;
+    constexpr static int no_path = -2;
+    constexpr static unsigned max_spins = 64;
+
+    // a writer preempted inside its stripe is not waited out when there are more threads than cores
+    static void backoff(unsigned spins) noexcept {
+        if (spins < max_spins) {
+            _mm_pause();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    static unsigned left_stripe(unsigned l) noexcept {
+        return l%stripes;
+    }
+
+    static unsigned right_stripe(unsigned r) noexcept {
+        return (r + stripes/2)%stripes;
+    }
+
+    static bool contains(const tables &t, unsigned l, unsigned r, T item) noexcept {
+        return t.left[4*l].load(std::memory_order_relaxed) == item || t.left[4*l + 1].load(std::memory_order_relaxed) == item
+            || t.left[4*l + 2].load(std::memory_order_relaxed) == item || t.left[4*l + 3].load(std::memory_order_relaxed) == item
+            || t.right[r].load(std::memory_order_relaxed) == item;
+    }
+
+    static std::atomic<T>* free_slot(const tables &t, unsigned l, unsigned r) noexcept {
+        for (auto i = 0u; i < 4; i++) {
+            if (t.left[4*l + i].load(std::memory_order_relaxed) == empty) {
+                return &t.left[4*l + i];
+            }
+        }
+        return (t.right[r].load(std::memory_order_relaxed) == empty)? &t.right[r] : nullptr;
+    }
+
+    static std::atomic<T>& at(const tables &t, const node &position) noexcept {
+        return position.is_left? t.left[position.index] : t.right[position.index];
+    }
+
+    static unsigned stripe(const node &position) noexcept {
+        return position.is_left? left_stripe(position.index/4) : right_stripe(position.index);
+    }
+
+    /* BFS over keys occupying the candidate locations, then the locations of their alternatives and so on,
+     * until some alternative has a free slot. Fills path with visited nodes and end with the free destination,
+     * returns index of the node to move there (-1 if a candidate location got freed meanwhile)
+     * or no_path when nothing was found within max_path_nodes.
+     */
+    static int find_path(const tables &t, unsigned l, unsigned r, std::vector<node> &path, node &end) {
+        path.clear();
+        for (auto i = 0u; i < 4; i++) {
+            path.push_back({true, 4*l + i, t.left[4*l + i].load(std::memory_order_relaxed), -1});
+        }
+        path.push_back({false, r, t.right[r].load(std::memory_order_relaxed), -1});
+        for (auto k = 0u; k < path.size() && path.size() < max_path_nodes; k++) {
+            const auto from = path[k];
+            if (from.key == empty) {
+                // freed meanwhile, move the keys before it there
+                end = from;
+                return from.parent;
+            }
+            if (from.is_left) {
+                const auto to = t.h_right(from.key);
+                const auto key = t.right[to].load(std::memory_order_relaxed);
+                if (key == empty) {
+                    end = {false, to, empty, int(k)};
+                    return int(k);
+                }
+                path.push_back({false, to, key, int(k)});
+            } else {
+                const auto to = t.h_left(from.key);
+                for (auto i = 0u; i < 4; i++) {
+                    const auto key = t.left[4*to + i].load(std::memory_order_relaxed);
+                    if (key == empty) {
+                        end = {true, 4*to + i, empty, int(k)};
+                        return int(k);
+                    }
+                    path.push_back({true, 4*to + i, key, int(k)});
+                }
             }
         }
-        return from;
+        return no_path;
     }
 
-    unsigned rehash_counter;
+    /* Moves keys one step each, starting from the free end; returns false if some location changed meanwhile.
+     * For published tables only, every move takes the stripes that readers of them validate against.
+     */
+    bool move_along(const tables &t, const std::vector<node> &path, int last, node destination) {
+        for (auto k = last; k >= 0; k = path[k].parent) {
+            const auto &source = path[k];
+            stripes_guard guard(*this, stripe(source), stripe(destination));
+            auto &from = at(t, source);
+            auto &to = at(t, destination);
+            if (from.load(std::memory_order_relaxed) != source.key || to.load(std::memory_order_relaxed) != empty) {
+                return false;
+            }
+            to.store(source.key, std::memory_order_relaxed);
+            from.store(empty, std::memory_order_relaxed);
+            destination = source;
+        }
+        return true;
+    }
+
+    // move_along for tables no other thread can see yet: plain stores, no stripes and nothing to recheck
+    static void shift_along(const tables &t, const std::vector<node> &path, int last, node destination) noexcept {
+        for (auto k = last; k >= 0; k = path[k].parent) {
+            at(t, destination).store(path[k].key, std::memory_order_relaxed);
+            at(t, path[k]).store(empty, std::memory_order_relaxed);
+            destination = path[k];
+        }
+    }
+
+    void resize(const tables *seen) {
+        std::unique_lock writers(resize_lock);
+        if (current.load(std::memory_order_relaxed) != seen) {
+            return;
+        }
+        // like set: a failure at low load is a cycle, new seeds at the same capacity are tried first
+        auto left_size = seen->left_capacity, right_size = seen->right_capacity;
+        if (n.load(std::memory_order_relaxed) < max_reseed_alpha*(4*left_size + right_size) && reseeds_in_row < max_reseeds) {
+            reseed_counter.fetch_add(1, std::memory_order_relaxed);
+            reseeds_in_row++;
+        } else {
+            rehash_counter.fetch_add(1, std::memory_order_relaxed);
+            reseeds_in_row = 0;
+            left_size = prime(2*left_size);
+            right_size = prime(left_size);
+        }
+        for (;;) {
+            auto fresh = std::make_unique<tables>(left_size, right_size, seed_state);
+            if (copy(*seen, *fresh)) {
+                current.store(fresh.get(), std::memory_order_release);
+                retired.push_back(std::move(fresh));
+                return;
+            }
+            rehash_counter.fetch_add(1, std::memory_order_relaxed);
+            reseeds_in_row = 0;
+            left_size = prime(2*left_size);
+            right_size = prime(left_size);
+        }
+    }
+
+    /* Single threaded reinsert into not yet published tables, false if some key didn't fit. Stripes are
+     * shared by all tables, so displacements here don't touch them and readers of the live tables go on.
+     */
+    static bool copy(const tables &from, tables &to) {
+        std::vector<node> path;
+        node end;
+        auto place = [&](T item) {
+            const auto l = to.h_left(item), r = to.h_right(item);
+            if (auto slot = free_slot(to, l, r)) {
+                slot->store(item, std::memory_order_relaxed);
+                return true;
+            }
+            const auto last = find_path(to, l, r, path, end);
+            if (last == no_path) {
+                return false;
+            }
+            shift_along(to, path, last, end);
+            free_slot(to, l, r)->store(item, std::memory_order_relaxed);
+            return true;
+        };
+        for (auto i = 0u; i < 4*from.left_capacity; i++) {
+            const auto item = from.left[i].load(std::memory_order_relaxed);
+            if (item != empty && !place(item)) {
+                return false;
+            }
+        }
+        for (auto i = 0u; i < from.right_capacity; i++) {
+            const auto item = from.right[i].load(std::memory_order_relaxed);
+            if (item != empty && !place(item)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    constexpr static float max_reseed_alpha = 0.75f;
+    constexpr static unsigned max_reseeds = 2;
+
+    // both guarded by resize_lock, seed_state also read by the constructor
+    uint64_t seed_state = UINT64_C(0x2545f4914f6cdd1d);
+    unsigned reseeds_in_row = 0;
+    std::atomic<const tables*> current;
+    std::vector<std::unique_ptr<const tables>> retired;
+    std::shared_mutex resize_lock;
+    mutable version versions[stripes];
+    alignas(64) std::atomic<unsigned> n = 0;
+};
+
+/* Approximate membership: Bits-bit fingerprints (8..16) in the same 4-slot buckets as set, in one
+ * table of m buckets. Partial-key cuckoo hashing: the second bucket of a key is
+ * (hash(fingerprint) - first) mod m, so a fingerprint can be moved to its other bucket without
+ * the key. It's an involution for any m, unlike the usual xor which needs a power of two.
+ * No false negatives; false positive rate is about 8/2^Bits (2 buckets * 4 slots), e.g. 3% for 8 bits,
+ * 0.2% for 12, 0.012% for 16. Up to ~95% of slots can be filled.
+ * erase() may only be called for inserted keys, and once per insert - the same key inserted twice is
+ * kept twice, like a counting filter, so deleting never removes a fingerprint another key relies on.
+ */
+template<unsigned Bits = 12, class Hasher = hashers::murmur3>
+class filter {
+    static_assert(Bits >= 8 && Bits <= 16);
+public:
+    using fingerprint_type = std::conditional_t<(Bits <= 8), uint8_t, uint16_t>;
+    constexpr static double false_positive_rate = 8.0/(1u << Bits);
+
+    filter(const filter&) = delete;
+    filter& operator=(const filter&) = delete;
+
+    // room for about capacity keys at 95% load
+    explicit filter(unsigned capacity)
+        : modulo(std::max(2u, unsigned(capacity/(4*0.95f)) + 1)), table(modulo.divisor, bucket{}) {}
+
+    // false when the filter is full, key is not added then
+    template<class T>
+    bool insert(T item) {
+        if (victim_used) {
+            return false;
+        }
+        auto [i, fp] = locate(item);
+        for (auto index : {i, alternative(i, fp)}) {
+            if (auto free = match(table[index], 0)) {
+                table[index].slot[__builtin_ctz(free)] = fp;
+                n++;
+                return true;
+            }
+        }
+        // random walk, the kicked out fingerprint always knows its other bucket
+        auto index = ((kick_state++) & 1)? alternative(i, fp) : i;
+        for (auto kick = 0u; kick < max_kicks; kick++) {
+            std::swap(fp, table[index].slot[(kick_state++) & 3]);
+            index = alternative(index, fp);
+            if (auto free = match(table[index], 0)) {
+                table[index].slot[__builtin_ctz(free)] = fp;
+                n++;
+                return true;
+            }
+        }
+        // last kicked out fingerprint is kept aside, no key is ever lost
+        victim = {index, fp};
+        victim_used = true;
+        n++;
+        return true;
+    }
+
+    template<class T>
+    bool contains(T item) const noexcept {
+        auto [i, fp] = locate(item);
+        const auto j = alternative(i, fp);
+        __builtin_prefetch(&table[j]);
+        return has(table[i], fp) || has(table[j], fp)
+            || (victim_used && victim.fingerprint == fp && (victim.index == i || victim.index == j));
+    }
+
+    template<class T>
+    bool erase(T item) noexcept {
+        auto [i, fp] = locate(item);
+        const auto j = alternative(i, fp);
+        if (victim_used && victim.fingerprint == fp && (victim.index == i || victim.index == j)) {
+            victim_used = false;
+            n--;
+            return true;
+        }
+        for (auto index : {i, j}) {
+            if (auto hit = match(table[index], fp)) {
+                table[index].slot[__builtin_ctz(hit)] = 0;
+                n--;
+                // room for the victim, if it is in the same pair of buckets
+                if (victim_used && (victim.index == index || alternative(victim.index, victim.fingerprint) == index)) {
+                    victim_used = false;
+                    n--;
+                    insert_fingerprint(index, victim.fingerprint);
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    unsigned size() const noexcept {
+        return n;
+    }
+
+    unsigned capacity() const noexcept {
+        return 4*modulo.divisor;
+    }
+
+    float bits_per_key() const noexcept {
+        return 8.0f*sizeof(bucket)*table.size()/std::max(1u, n);
+    }
+
+private:
+    struct alignas(4*sizeof(fingerprint_type)) bucket {
+        fingerprint_type slot[4] = {};
+    };
+
+    struct entry {
+        unsigned index;
+        fingerprint_type fingerprint;
+    };
+
+    // bucket from the high half of the hash, non zero fingerprint from the low bits
+    template<class T>
+    std::pair<unsigned, fingerprint_type> locate(T item) const noexcept {
+        const auto hash = Hasher::hash(uint64_t(item));
+        auto fp = fingerprint_type(hash & ((1u << Bits) - 1));
+        fp += (fp == 0);
+        return {modulo(uint32_t(hash >> 32)), fp};
+    }
+
+    unsigned alternative(unsigned index, fingerprint_type fp) const noexcept {
+        const auto h = modulo(uint32_t(hashers::murmur3::hash(fp)));
+        return (h >= index)? h - index : h + modulo.divisor - index;
+    }
+
+    // bit i set when slot[i] == fp
+    static unsigned match(const bucket &b, fingerprint_type fp) noexcept {
+        return unsigned(b.slot[0] == fp) | unsigned(b.slot[1] == fp) << 1
+            | unsigned(b.slot[2] == fp) << 2 | unsigned(b.slot[3] == fp) << 3;
+    }
+
+    // whole bucket as one word, zero lane test (SWAR) of bucket ^ broadcast fp
+    static bool has(const bucket &b, fingerprint_type fp) noexcept {
+        using word = std::conditional_t<(sizeof(fingerprint_type) == 1), uint32_t, uint64_t>;
+        constexpr auto ones = word(~word(0))/word(fingerprint_type(~0u));
+        constexpr auto highs = ones << (8*sizeof(fingerprint_type) - 1);
+        word lanes;
+        std::memcpy(&lanes, b.slot, sizeof(lanes));
+        lanes ^= ones*fp;
+        return ((lanes - ones) & ~lanes & highs) != 0;
+    }
+
+    void insert_fingerprint(unsigned index, fingerprint_type fp) noexcept {
+        table[index].slot[__builtin_ctz(match(table[index], 0))] = fp;
+        n++;
+    }
+
+    constexpr static unsigned max_kicks = 500;
+
+    const fast_mod modulo;
+    std::vector<bucket> table;
+    unsigned n = 0;
+    unsigned kick_state = 0;
+    entry victim = {};
+    bool victim_used = false;
 };
 
 }
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+/* Executors for bulk operations: concurrency() tasks, run(f) calls f(0) .. f(concurrency() - 1)
+ * in parallel and returns when all of them are done.
+ */
+namespace executors {
+
+struct serial {
+    unsigned concurrency() const noexcept {
+        return 1;
+    }
+
+    template<class F>
+    void run(F &&f) const {
+        f(0u);
+    }
+};
+
+// fresh std::threads per run, task 0 goes on the calling thread
+class threads {
+public:
+    explicit threads(unsigned number = std::thread::hardware_concurrency())
+        : count(std::max(number, 1u)) {}
+
+    unsigned concurrency() const noexcept {
+        return count;
+    }
+
+    template<class F>
+    void run(F &&f) const {
+        std::vector<std::thread> workers;
+        workers.reserve(count - 1);
+        for (auto t = 1u; t < count; t++) {
+            workers.emplace_back([&f, t] { f(t); });
+        }
+        f(0u);
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+private:
+    unsigned count;
+};
+
+}
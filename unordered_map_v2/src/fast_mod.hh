@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <cassert>
+#include <cmath>
+
+/* x % d for a runtime d without a div instruction (Lemire, Kaser, Kurz, "Faster Remainder by Direct
+ * Computation"). The 64-bit reciprocal is computed once per divisor, so tables keep one next to their
+ * capacity and refresh it on rehash. Exact for every 32-bit x and d > 0.
+ */
+struct fast_mod {
+    __extension__ using uint128 = unsigned __int128;
+
+    fast_mod() = default;
+
+    explicit fast_mod(uint32_t d)
+        : divisor(d), reciprocal(UINT64_C(0xFFFFFFFFFFFFFFFF)/d + 1) {
+        assert(d > 0);
+    }
+
+    uint32_t operator()(uint32_t x) const {
+        const uint64_t lowbits = reciprocal*x;
+        return static_cast<uint32_t>((uint128(lowbits)*divisor) >> 64);
+    }
+
+    uint32_t divisor = 1;
+    uint64_t reciprocal = 0;
+};
+
+// next prime above from, by trial division. Capacity of the prime sized tables
+inline unsigned prime(unsigned from) noexcept {
+    for (;;) {
+        from++;
+        auto last = unsigned(sqrt(from)) + 1u;
+        auto i = 2u;
+        for (; i <= last; i++)
+            if (from % i == 0) {
+                break;
+            }
+        if (i == last + 1) {
+            break;
+        }
+    }
+    return from;
+}
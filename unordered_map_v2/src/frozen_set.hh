@@ -0,0 +1,246 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <utility>
+#include <span>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+#include <stdexcept>
+#include "hashers.hh"
+
+namespace frozen {
+
+/* Immutable set built once from a key vector, on top of a PtrHash style minimal perfect hash.
+ * Keys go to n/lambda buckets, every bucket has an 8-bit pilot chosen at build time so that
+ * slot = reduce((hash ^ C*pilot)*C') of its keys hits only free slots. A lookup is two dependent
+ * accesses, the pilot of its bucket and then the one key at its slot, with no probing. Pilots take
+ * n/lambda bytes, only while they fit in L2 (~3M keys with 2MB L2) the first access hits and a lookup
+ * costs about one miss. Above that both miss: at 10M keys (3.3MB of pilots) contains() takes ~1.5x
+ * of a hash plus one key access.
+ * Slots are n/alpha, the few unused ones hold a copy of some key from the set, so they never
+ * match a key that isn't in the set and no empty sentinel is needed.
+ * Overhead is 8/lambda bits/key for pilots plus (1/alpha - 1)*sizeof(T)*8 for unused slots,
+ * ~3 bits/key for int keys.
+ * Pilots are placed largest bucket first. When no pilot gives free slots, the one that displaces
+ * the smallest buckets wins and those are queued again (eviction, as in PtrHash), buckets placed
+ * recently are never displaced. If that doesn't settle the build starts over with another seed.
+ */
+template<class T = int, class Hasher = hashers::murmur3>
+class set {
+    // hash takes the value as uint64_t, so distinct keys have to stay distinct there
+    static_assert(std::is_integral_v<T> && sizeof(T) <= sizeof(uint64_t));
+public:
+    using key_type = T;
+
+    /* Duplicates are allowed. Throws std::runtime_error when max_rebuilds seeds didn't place the keys,
+     * which takes a Hasher mapping distinct keys to the same hash.
+     */
+    explicit set(std::span<const T> items) {
+        std::vector<T> unique(items.begin(), items.end());
+        std::sort(unique.begin(), unique.end());
+        unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+        n = unsigned(unique.size());
+        if (n == 0) {
+            return;
+        }
+        bucket_count = std::max(1u, unsigned(n/lambda));
+        slot_count = std::max(n, unsigned(n/alpha));
+        for (auto seed_state = initial_seed;;) {
+            seed = hashers::multiply_shift::splitmix64(seed_state);
+            if (place(unique)) {
+                break;
+            }
+            if (++rebuilds == max_rebuilds) {
+                throw std::runtime_error("frozen::set: no seed places the keys, Hasher collides");
+            }
+        }
+    }
+
+    bool contains(T item) const noexcept {
+        if (n == 0) {
+            return false;
+        }
+        return keys[index(item)] == item;
+    }
+
+    // perfect hash of item in [0, slots()), meaningful only for items of the set
+    unsigned index(T item) const noexcept {
+        const auto h = hash(item);
+        return slot(h, pilots[bucket(h)]);
+    }
+
+    unsigned size() const noexcept {
+        return n;
+    }
+
+    unsigned slots() const noexcept {
+        return slot_count;
+    }
+
+    // beyond sizeof(T)*8 per key: pilots and unused slots
+    float bits_per_key() const noexcept {
+        return n == 0? 0.0f : (8.0f*pilots.size() + 8.0f*sizeof(T)*(slot_count - n))/n;
+    }
+
+    unsigned rebuilds = 0;
+    unsigned evictions = 0;
+private:
+    uint64_t hash(T item) const noexcept {
+        return Hasher::hash(uint64_t(item) ^ seed);
+    }
+
+    unsigned bucket(uint64_t h) const noexcept {
+        return unsigned(((h >> 32)*bucket_count) >> 32);
+    }
+
+    unsigned slot(uint64_t h, uint8_t pilot) const noexcept {
+        const auto x = (h ^ (pilot_multiplier*pilot))*slot_multiplier;
+        return unsigned(((x >> 32)*slot_count) >> 32);
+    }
+
+    bool place(const std::vector<T> &unique) {
+        // hashes grouped by bucket, counting sort
+        std::vector<unsigned> first(bucket_count + 1);
+        for (auto item : unique) {
+            first[bucket(hash(item)) + 1]++;
+        }
+        for (auto b = 0u; b < bucket_count; b++) {
+            first[b + 1] += first[b];
+        }
+        std::vector<uint64_t> hashes(n);
+        {
+            auto next = first;
+            for (auto item : unique) {
+                const auto h = hash(item);
+                hashes[next[bucket(h)]++] = h;
+            }
+        }
+        auto bucket_size = [&](unsigned b) {
+            return first[b + 1] - first[b];
+        };
+        // largest bucket first, evicted ones come back by their size too
+        std::priority_queue<std::pair<unsigned, unsigned>> pending;
+        for (auto b = 0u; b < bucket_count; b++) {
+            if (bucket_size(b) != 0) {
+                pending.push({bucket_size(b), b});
+            }
+        }
+        pilots.assign(bucket_count, 0);
+        std::vector<unsigned> owner(slot_count, none);
+        // same as owner[s] != none, but fits in cache for the pilot search
+        std::vector<uint64_t> occupied(slot_count/64 + 1, 0);
+        auto is_free = [&](unsigned s) {
+            return (occupied[s/64] & (UINT64_C(1) << (s%64))) == 0;
+        };
+        auto state = seed;
+        const auto eviction_limit = 16ull*n + 1024;
+        auto local_evictions = 0ull;
+        unsigned taken[max_bucket];
+        // last placed buckets are not evicted again, otherwise two of them can take turns forever
+        unsigned recent[recent_window];
+        std::fill_n(recent, recent_window, none);
+        auto placed = 0u;
+        auto is_recent = [&](unsigned b) {
+            return std::find(recent, recent + recent_window, b) != recent + recent_window;
+        };
+        while (!pending.empty()) {
+            const auto b = pending.top().second;
+            pending.pop();
+            const auto size = bucket_size(b);
+            if (size > max_bucket) {
+                return false;
+            }
+            auto slots_of = [&](unsigned pilot) {
+                for (auto k = 0u; k < size; k++) {
+                    taken[k] = slot(hashes[first[b] + k], uint8_t(pilot));
+                    for (auto l = 0u; l < k; l++) {
+                        if (taken[l] == taken[k]) {
+                            return false;
+                        }
+                    }
+                }
+                return true;
+            };
+            auto chosen = none;
+            for (auto pilot = 0u; pilot < 256 && chosen == none; pilot++) {
+                if (slots_of(pilot) && std::all_of(taken, taken + size, is_free)) {
+                    chosen = pilot;
+                }
+            }
+            if (chosen == none) {
+                // cheapest displacement, random start so that two buckets don't evict each other forever
+                auto best_cost = ~0u;
+                const auto start = unsigned(hashers::multiply_shift::splitmix64(state));
+                for (auto i = 0u; i < 256; i++) {
+                    const auto pilot = (start + i) & 255;
+                    if (!slots_of(pilot)) {
+                        continue;
+                    }
+                    auto cost = 0u;
+                    for (auto k = 0u; k < size && cost != ~0u; k++) {
+                        if (!is_free(taken[k])) {
+                            const auto other = owner[taken[k]];
+                            cost = is_recent(other)? ~0u : cost + bucket_size(other)*bucket_size(other);
+                        }
+                    }
+                    if (cost < best_cost) {
+                        best_cost = cost;
+                        chosen = pilot;
+                    }
+                }
+                if (chosen == none || ++local_evictions > eviction_limit) {
+                    return false;
+                }
+                slots_of(chosen);
+                for (auto k = 0u; k < size; k++) {
+                    const auto other = owner[taken[k]];
+                    if (other == none) {
+                        continue;
+                    }
+                    for (auto l = first[other]; l < first[other + 1]; l++) {
+                        const auto s = slot(hashes[l], pilots[other]);
+                        owner[s] = none;
+                        occupied[s/64] &= ~(UINT64_C(1) << (s%64));
+                    }
+                    pending.push({bucket_size(other), other});
+                }
+            }
+            slots_of(chosen);
+            for (auto k = 0u; k < size; k++) {
+                owner[taken[k]] = b;
+                occupied[taken[k]/64] |= UINT64_C(1) << (taken[k]%64);
+            }
+            pilots[b] = uint8_t(chosen);
+            recent[placed++ % recent_window] = b;
+        }
+        evictions += unsigned(local_evictions);
+        keys.assign(slot_count, unique.front());
+        for (auto item : unique) {
+            keys[index(item)] = item;
+        }
+        return true;
+    }
+
+    constexpr static float lambda = 3.0f;
+    constexpr static float alpha = 0.99f;
+    constexpr static unsigned max_bucket = 32;
+    constexpr static unsigned recent_window = 16;
+    constexpr static unsigned max_rebuilds = 32;
+    constexpr static unsigned none = ~0u;
+    constexpr static uint64_t pilot_multiplier = UINT64_C(0x517cc1b727220a95);
+    constexpr static uint64_t slot_multiplier = UINT64_C(0x9e3779b97f4a7c15);
+    // fixed, builds are repeatable
+    constexpr static uint64_t initial_seed = UINT64_C(0x2545f4914f6cdd1d);
+
+    unsigned n = 0;
+    unsigned bucket_count = 0;
+    unsigned slot_count = 0;
+    uint64_t seed = 0;
+    std::vector<uint8_t> pilots;
+    std::vector<T> keys;
+};
+
+}
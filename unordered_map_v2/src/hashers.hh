@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+
+/* Key mixers pluggable into the tables as Hasher. Each maps a key (widened to 64 bits) to a 64-bit
+ * hash and the table reduces it to a slot, so identity keeps the old content % m behaviour.
+ */
+namespace hashers {
+
+struct identity {
+    static uint64_t hash(uint64_t x) noexcept {
+        return x;
+    }
+};
+
+// murmur3 fmix64 finalizer, every input bit affects every output bit
+struct murmur3 {
+    static uint64_t hash(uint64_t x) noexcept {
+        x ^= x >> 33;
+        x *= UINT64_C(0xff51afd7ed558ccd);
+        x ^= x >> 33;
+        x *= UINT64_C(0xc4ceb9fe1a85ec53);
+        x ^= x >> 33;
+        return x;
+    }
+};
+
+// wyhash/xxh3 style: 64x64->128 multiply of two differently salted copies of the key, halves folded together
+struct wyhash {
+    __extension__ using uint128 = unsigned __int128;
+
+    static uint64_t hash(uint64_t x) noexcept {
+        const auto r = uint128(x ^ UINT64_C(0xa0761d6478bd642f))*(x ^ UINT64_C(0xe7037ed1a0b428db));
+        return uint64_t(r) ^ uint64_t(r >> 64);
+    }
+};
+
+/* Seeded multiply-add-shift (Dietzfelbinger): top 32 bits of a*x + b with random odd a. Functions with
+ * different seeds are independent, tables with two choices (cuckoo) use one per side on top of Hasher.
+ */
+struct multiply_shift {
+    multiply_shift() = default;
+
+    // draws a and b from a splitmix64 sequence, state is advanced
+    explicit multiply_shift(uint64_t &state) noexcept
+        : a(splitmix64(state) | 1), b(splitmix64(state)) {}
+
+    uint32_t operator()(uint64_t x) const noexcept {
+        return uint32_t((a*x + b) >> 32);
+    }
+
+    static uint64_t splitmix64(uint64_t &state) noexcept {
+        auto z = (state += UINT64_C(0x9e3779b97f4a7c15));
+        z = (z ^ (z >> 30))*UINT64_C(0xbf58476d1ce4e5b9);
+        z = (z ^ (z >> 27))*UINT64_C(0x94d049bb133111eb);
+        return z ^ (z >> 31);
+    }
+
+    uint64_t a = 1;
+    uint64_t b = 0;
+};
+
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <type_traits>
+#include <limits>
+#include <cassert>
+#include <cstdint>
+#include <algorithm>
+#include "fast_mod.hh"
+#include "hashers.hh"
+
+namespace hopscotch {
+
+/* Every key lives within H slots of its home bucket and the home bucket keeps an H-bit bitmap
+ * of which of those slots hold its keys. A lookup reads the bitmap and compares only the marked
+ * slots - one cache line of bitmaps and usually one of keys, whatever the load factor. Insert takes
+ * the nearest free slot and, while it is too far, hops it backwards by moving a closer entry
+ * (one whose home still covers the free slot) into it. A rehash is needed only when no entry
+ * can be moved: with H = 64 that starts around 0.93 alpha, with H = 32 around 0.85.
+ * There are H - 1 extra slots past the last home bucket so neighbourhoods never wrap around.
+ */
+template<class T = int, class Hasher = hashers::identity, unsigned H = 64>
+class set {
+    static_assert(std::is_integral_v<T>);
+    static_assert(H > 0 && H <= 64);
+public:
+    set(const set&) = delete;
+    set& operator=(const set&) = delete;
+
+    using key_type = T;
+    set(unsigned size, float load_factor = 0.95f)
+        : _capacity(size), max_load_factor(load_factor) {
+        // best speed when capacity is prime
+        assert(max_load_factor > 0.0f && max_load_factor < 1.0f);
+        allocate();
+    }
+
+    ~set() {
+        delete[] hops;
+        delete[] keys;
+    }
+
+    void insert(T item) {
+        assert(item != empty);
+        const auto h = home(item);
+        if (find(item, h) >= 0) {
+            return;
+        }
+        if (n >= grow_threshold) {
+            rehash();
+            insert(item);
+            return;
+        }
+        auto free = find_free(h);
+        while (free >= 0 && unsigned(free) - h >= H) {
+            free = hop_back(unsigned(free));
+        }
+        if (free < 0) {
+            rehash();
+            insert(item);
+            return;
+        }
+        keys[free] = item;
+        hops[h] |= bitmap(1) << (free - h);
+        n++;
+    }
+
+    void erase(T item) {
+        const auto h = home(item);
+        auto i = find(item, h);
+        if (i >= 0) {
+            keys[i] = empty;
+            hops[h] &= ~(bitmap(1) << (i - h));
+            n--;
+        }
+    }
+
+    bool search(T item) const {
+        return find(item, home(item)) >= 0;
+    }
+
+    unsigned size() const {
+        return n;
+    }
+
+    unsigned capacity() const {
+        return _capacity;
+    }
+
+    mutable unsigned collisions = 0;
+    unsigned rehash_counter = 0;
+private:
+    using bitmap = std::conditional_t<(H > 32), uint64_t, uint32_t>;
+
+    constexpr static auto empty = std::numeric_limits<T>::min();
+    // how far insert looks for a free slot before giving up and rehashing
+    constexpr static unsigned max_free_distance = 8192;
+
+    unsigned home(T item) const {
+        return modulo(uint32_t(Hasher::hash(uint64_t(item))));
+    }
+
+    int find(T item, unsigned h) const {
+        for (auto bits = hops[h]; bits != 0; bits &= bits - 1) {
+            const auto i = h + __builtin_ctzll(bits);
+            if (keys[i] == item) {
+                return int(i);
+            }
+            collisions++;
+        }
+        return -1;
+    }
+
+    int find_free(unsigned h) const {
+        const auto last = std::min(h + max_free_distance, slots());
+        for (auto i = h; i < last; i++) {
+            if (keys[i] == empty) {
+                return int(i);
+            }
+        }
+        return -1;
+    }
+
+    // moves into free slot an entry from the H - 1 slots before it, returns slot freed that way or -1
+    int hop_back(unsigned free) {
+        for (auto b = free - (H - 1); b < free; b++) {
+            for (auto bits = hops[b]; bits != 0; bits &= bits - 1) {
+                const auto i = b + __builtin_ctzll(bits);
+                if (i >= free) {
+                    break;
+                }
+                keys[free] = keys[i];
+                keys[i] = empty;
+                hops[b] = (hops[b] & ~(bitmap(1) << (i - b))) | (bitmap(1) << (free - b));
+                return int(i);
+            }
+        }
+        return -1;
+    }
+
+    unsigned slots() const {
+        return _capacity + H - 1;
+    }
+
+    void allocate() {
+        keys = new T[slots()];
+        hops = new bitmap[slots()];
+        std::fill_n(keys, slots(), empty);
+        std::fill_n(hops, slots(), bitmap(0));
+        modulo = fast_mod(_capacity);
+        grow_threshold = unsigned(max_load_factor*_capacity);
+    }
+
+    void rehash() {
+        rehash_counter++;
+        auto old_keys = keys;
+        auto old_slots = slots();
+        delete[] hops;
+        _capacity = prime(2*_capacity);
+        allocate();
+        n = 0;
+        for (auto i = 0u; i < old_slots; i++) {
+            if (old_keys[i] != empty) {
+                insert(old_keys[i]);
+            }
+        }
+        delete[] old_keys;
+    }
+
+    unsigned n = 0;
+    unsigned _capacity;
+    float max_load_factor;
+    unsigned grow_threshold = 0;
+    // bitmaps apart from keys, so a key cache line holds 64/sizeof(T) slots
+    T *keys = nullptr;
+    bitmap *hops = nullptr;
+    fast_mod modulo;
+};
+
+}
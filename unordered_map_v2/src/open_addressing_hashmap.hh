@@ -6,10 +6,23 @@
 #include <algorithm>
 #include <cmath>
 #include <type_traits>
+#include <cstdint>
+#include <span>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "fast_mod.hh"
+#include "hashers.hh"
+#include "bloom_filter.hh"
+#include "allocation.hh"
+#include "snapshot.hh"
+#include "executor.hh"
 
 namespace open_addressing {
 
-template<class T>
+// holder<int, 0> has all zero bytes for empty slot, so zeroed allocations need no initial fill
+template<class T, T Empty = T(-1)>
 struct holder {
     T content;
     bool mark;
@@ -23,64 +36,304 @@ struct holder {
         return content == infinity;
     }
 
-    bool operator==(const holder& h) {
+    bool operator==(const holder& h) const {
         return content == h.content;
     }
 
     static int hash(const holder& h, int m) {
         return h.content % m;
     }
-    constexpr static auto infinity = -1;
+    constexpr static T infinity = Empty;
 } __attribute__((packed));
 
 static_assert(std::is_fundamental_v<holder<int>::type>);
 static_assert(std::is_trivially_copyable_v<holder<int>> && std::is_standard_layout_v<holder<int>>);
 static_assert(std::has_unique_object_representations_v<holder<int>>);
 
-template<class Holder = holder<int>>
+using ::prime;
+
+// Capacity policies: initial and next capacity, home slot of a key and the probe sequence.
+
+struct prime_capacity {
+    static unsigned fit(unsigned size) {
+        return size;
+    }
+
+    static unsigned next(unsigned capacity) {
+        return prime(2*capacity);
+    }
+
+    // m is the capacity with its precomputed reciprocal, so neither home nor the wrap divides
+    static int home(uint64_t hash, const fast_mod &m) {
+        return int(m(uint32_t(hash)));
+    }
+
+    // j goes up to m/2, so j*j leaves int (and uint32_t) range for m above ~92k
+    static int probe(int k, int j, const fast_mod &m) {
+        const auto tmp = uint64_t(k) + uint64_t(j) + uint64_t(j)*uint64_t(j);
+        if (tmp < m.divisor) {
+            return int(tmp);
+        }
+        return (tmp <= UINT32_MAX)? int(m(uint32_t(tmp))) : int(tmp % m.divisor);
+    }
+};
+
+/* No division at all: murmur3 finalizer mixes the key, multiply-shift (Lemire's fastrange,
+ * top bits for power of two m) gives the home slot and triangular probing k + j(j+1)/2
+ * wraps with a mask while visiting every slot.
+ */
+struct power_of_two_capacity {
+    static unsigned fit(unsigned size) {
+        auto capacity = 1u;
+        while (capacity < size) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    static unsigned next(unsigned capacity) {
+        return 2*capacity;
+    }
+
+    static uint32_t mix(uint32_t x) {
+        x ^= x >> 16;
+        x *= 0x85ebca6bu;
+        x ^= x >> 13;
+        x *= 0xc2b2ae35u;
+        x ^= x >> 16;
+        return x;
+    }
+
+    // top bits are taken, so hash is mixed again: with identity Hasher they would be 0 for small keys
+    static int home(uint64_t hash, const fast_mod &m) {
+        return int((uint64_t(mix(uint32_t(hash)))*m.divisor) >> 32);
+    }
+
+    static int probe(int k, int j, const fast_mod &m) {
+        return int((unsigned(k) + ((unsigned(j)*unsigned(j + 1)) >> 1)) & (m.divisor - 1));
+    }
+};
+
+/* Filter is consulted before the probe loop, with bloom::blocked most misses never touch the table.
+ * It holds keys of the current table (old_filter of the old one during migration) and is rebuilt by compact().
+ * Allocator backs the slot arrays (allocation::heap, huge_pages or hugetlb).
+ * save() writes slots to a snapshot file, load() maps it back and uses the mapping as the table.
+ */
+template<class Holder = holder<int>, class Capacity = prime_capacity, class Hasher = hashers::identity,
+         class Filter = bloom::none, class Allocator = allocation::heap>
 class set {
 public:
     set(const set&) = delete;
     set& operator=(const set&) = delete;
 
     using key_type = typename Holder::type;
-    set(unsigned size)
-        : _capacity(size) {
-        // best speed when capacity is prime
-        table = new Holder[capacity()];
-        for (auto i = 0u; i < capacity(); i++) {
-            auto &e = table[i];
-            e.mark = false;
-            e.init_as_empty();
-        }
+    set(unsigned size, float load_factor = 0.75f, float tombstone_ratio = 0.2f)
+        : _capacity(Capacity::fit(size)), max_load_factor(load_factor), max_tombstone_ratio(tombstone_ratio),
+          filter(unsigned(load_factor*_capacity)), old_filter(0) {
+        // best speed with prime_capacity when capacity is prime
+        assert(max_load_factor > 0.0f && max_load_factor < 1.0f);
+        assert(max_tombstone_ratio > 0.0f && max_tombstone_ratio < max_load_factor);
+        table = allocate(capacity());
+        modulo = fast_mod(capacity());
+        update_thresholds();
     }
 
     ~set() {
-        delete[] table;
+        deallocate(next_table, next_capacity);
+        deallocate(old_table, old_capacity);
+        deallocate(table, _capacity);
     }
 
     void insert(key_type item) {
+        rehash_step();
+        if (n + tombstones >= grow_threshold) {
+            grow();
+        } else if (n + tombstones >= prepare_threshold && !next_table) {
+            prepare();
+        }
         Holder c = {item, false};
-        auto i = process_search__false(c);
-        if (!(table[i] == c)) {
+        if (old_table && old_search(c) >= 0) {
+            return;
+        }
+        auto i = process_search__false(table, modulo, c);
+        // quadratic probe visits only ~m/2 slots, so it can run out before the table is full
+        while (i < 0) {
+            grow();
+            i = process_search__false(table, modulo, c);
+        }
+        if (table[i].is_empty() || table[i].mark) {
+            if (table[i].mark) {
+                tombstones--;
+            }
             table[i] = std::move(c);
+            filter.insert(uint64_t(item));
             n++;
         }
     }
 
+    /* Bulk load of an empty set, capacity grows first if keys don't fit. Keys are radix partitioned
+     * by home slot into one contiguous slot range per task and every task fills only its own range,
+     * without locks. A key whose probe sequence leaves its range (wraps or jumps over the boundary,
+     * only near range ends) is left over and inserted serially at the end, as is Filter.
+     */
+    template<class Executor = executors::threads>
+    void build(std::span<const key_type> keys, const Executor &executor = Executor()) {
+        assert(n == 0 && tombstones == 0 && !old_table);
+        if (keys.size() >= grow_threshold) {
+            deallocate(table, _capacity);
+            while (keys.size() >= unsigned(max_load_factor*_capacity)) {
+                _capacity = Capacity::next(_capacity);
+            }
+            table = allocate(_capacity);
+            modulo = fast_mod(_capacity);
+            update_thresholds();
+            filter = Filter(grow_threshold);
+        }
+        const auto tasks = executor.concurrency();
+        const auto &m = modulo;
+        auto partition = [&](int slot) {
+            return unsigned(uint64_t(slot)*tasks/_capacity);
+        };
+        auto chunk = [&](unsigned t) {
+            return std::pair(keys.size()*t/tasks, keys.size()*(t + 1)/tasks);
+        };
+        // histogram of partitions over a chunk of keys per task, then scatter of keys with their homes
+        std::vector<std::size_t> counts(tasks*tasks);
+        executor.run([&](unsigned t) {
+            const auto [first, last] = chunk(t);
+            for (auto k = first; k < last; k++) {
+                counts[t*tasks + partition(home(keys[k], m))]++;
+            }
+        });
+        std::vector<std::size_t> offsets(tasks*tasks), bounds(tasks + 1);
+        auto sum = std::size_t(0);
+        for (auto p = 0u; p < tasks; p++) {
+            bounds[p] = sum;
+            for (auto t = 0u; t < tasks; t++) {
+                offsets[t*tasks + p] = sum;
+                sum += counts[t*tasks + p];
+            }
+        }
+        bounds[tasks] = sum;
+        std::vector<std::pair<key_type, int>> partitioned(keys.size());
+        executor.run([&](unsigned t) {
+            const auto [first, last] = chunk(t);
+            for (auto k = first; k < last; k++) {
+                const auto slot = home(keys[k], m);
+                partitioned[offsets[t*tasks + partition(slot)]++] = {keys[k], slot};
+            }
+        });
+        std::vector<std::vector<key_type>> leftovers(tasks);
+        std::vector<unsigned> inserted(tasks);
+        executor.run([&](unsigned p) {
+            // slots of partition p
+            const auto lo = int((uint64_t(p)*_capacity + tasks - 1)/tasks);
+            const auto hi = int((uint64_t(p + 1)*_capacity + tasks - 1)/tasks);
+            const int limit = m.divisor/2;
+            for (auto k = bounds[p]; k < bounds[p + 1]; k++) {
+                const auto [item, hash_holder] = partitioned[k];
+                Holder c = {item, false};
+                auto j = 0;
+                auto i = h(hash_holder, j, m);
+                for (;;) {
+                    if (i < lo || i >= hi || j > limit) {
+                        leftovers[p].push_back(item);
+                        break;
+                    }
+                    if (table[i].is_empty()) {
+                        table[i] = c;
+                        inserted[p]++;
+                        break;
+                    }
+                    if (table[i] == c) {
+                        break;
+                    }
+                    i = h(hash_holder, ++j, m);
+                }
+            }
+        });
+        for (auto count : inserted) {
+            n += count;
+        }
+        if constexpr (!std::is_same_v<Filter, bloom::none>) {
+            for (auto &[item, slot] : partitioned) {
+                filter.insert(uint64_t(item));
+            }
+        }
+        for (auto &rest : leftovers) {
+            for (auto item : rest) {
+                insert(item);
+            }
+        }
+    }
+
     void erase(key_type item) {
+        rehash_step();
         Holder c = {item, false};
-        auto i = process_search__true(c);
-        if (table[i] == c) {
-            c.mark = true;
+        auto i = process_search__true(table, modulo, c);
+        if (i >= 0 && !table[i].is_empty()) {
+            // content stays in place so that probe sequences running through the slot are not cut
+            table[i].mark = true;
+            tombstones++;
             n--;
+        } else if (old_table && (i = old_search(c)) >= 0) {
+            old_table[i].mark = true;
+            n--;
+        }
+        if (tombstones > compaction_threshold) {
+            compact();
         }
     }
 
-    bool search(key_type item) const {
+    bool search(key_type item) {
+        rehash_step();
         Holder c = {item, false};
-        auto i = process_search__true(c);
-        return table[i] == c;
+        if (filter.may_contain(uint64_t(item))) {
+            auto i = process_search__true(table, modulo, c);
+            if (i >= 0 && !table[i].is_empty()) {
+                return true;
+            }
+        }
+        return old_table && old_filter.may_contain(uint64_t(item)) && old_search(c) >= 0;
+    }
+
+    /* Group prefetching: home slots of up to `group` keys are prefetched before any of them
+     * is probed, so their cache misses overlap instead of being paid one after another.
+     * Returns number of hits, found[i] tells if keys[i] is present.
+     */
+    unsigned search_many(std::span<const key_type> keys, std::span<bool> found, unsigned group = 16) {
+        assert(found.size() >= keys.size() && group > 0 && group <= max_prefetch_group);
+        auto hits = 0u;
+        if (old_table) {
+            for (auto k = 0u; k < keys.size(); k++) {
+                found[k] = search(keys[k]);
+                hits += found[k];
+            }
+            return hits;
+        }
+        const auto &m = modulo;
+        int homes[max_prefetch_group];
+        for (auto first = 0u; first < keys.size(); first += group) {
+            const auto last = std::min<std::size_t>(first + group, keys.size());
+            for (auto k = first; k < last; k++) {
+                // filtered out keys are not prefetched nor probed
+                homes[k - first] = filter.may_contain(uint64_t(keys[k]))? home(keys[k], m) : -1;
+                if (homes[k - first] >= 0) {
+                    __builtin_prefetch(&table[homes[k - first]]);
+                }
+            }
+            for (auto k = first; k < last; k++) {
+                if (homes[k - first] < 0) {
+                    found[k] = false;
+                    continue;
+                }
+                Holder c = {keys[k], false};
+                auto i = process_search__true(table, m, c, homes[k - first]);
+                found[k] = i >= 0 && !table[i].is_empty();
+                hits += found[k];
+            }
+        }
+        return hits;
     }
 
     unsigned size() const {
@@ -91,45 +344,698 @@ public:
         return _capacity;
     }
 
+    // migration in progress is finished first, filter is not stored
+    void save(const std::string &file_name) {
+        if (old_table) {
+            migrate(old_capacity);
+        }
+        snapshot::header head = {};
+        head.slot_size = sizeof(Holder);
+        head.layout = snapshot::layout<Holder, Capacity, Hasher>();
+        head.count = n;
+        head.capacity[0] = _capacity;
+        head.tombstones = tombstones;
+        head.load_factor = max_load_factor;
+        head.tombstone_ratio = max_tombstone_ratio;
+        snapshot::write(file_name, head, std::as_bytes(std::span<const Holder>(table, _capacity)));
+    }
+
+    /* No rebuild, only Filter (if any) is filled from the slots. With mode::read_only only lookups
+     * are allowed, with mode::copy_on_write the set can be changed and grown as usual.
+     */
+    static set load(const std::string &file_name, snapshot::mode m = snapshot::mode::read_only) {
+        auto file = std::make_unique<snapshot::file>(file_name, m, sizeof(Holder), snapshot::layout<Holder, Capacity, Hasher>());
+        const auto &head = file->head();
+        const auto valid = head.load_factor > 0.0f && head.load_factor < 1.0f && head.tombstone_ratio > 0.0f
+            && head.tombstone_ratio < head.load_factor && head.tombstones + head.count <= head.capacity[0];
+        if (!valid) {
+            throw std::runtime_error("snapshot: " + file_name + " has wrong load factor or counts");
+        }
+        return set(std::move(file));
+    }
+
     mutable unsigned collisions = 0;
+    unsigned rehash_counter = 0;
+    unsigned compaction_counter = 0;
 private:
-    static int h(int k, int j, int m) {
-        auto tmp = k + j + j*j;
-        return (tmp >= m)? (tmp%m) : tmp;
+    explicit set(std::unique_ptr<snapshot::file> file)
+        : _capacity(unsigned(file->head().capacity[0])), max_load_factor(file->head().load_factor),
+          max_tombstone_ratio(file->head().tombstone_ratio), filter(unsigned(max_load_factor*_capacity)), old_filter(0) {
+        n = unsigned(file->head().count);
+        tombstones = file->head().tombstones;
+        table = file->section<Holder>(0);
+        modulo = fast_mod(capacity());
+        update_thresholds();
+        if constexpr (!std::is_same_v<Filter, bloom::none>) {
+            for (auto i = 0u; i < capacity(); i++) {
+                if (!table[i].is_empty() && !table[i].mark) {
+                    filter.insert(uint64_t(table[i].content));
+                }
+            }
+        }
+        mapped = std::move(file);
     }
 
-    int process_search__true(Holder &c) const {
-        const int m = capacity();
-        const int hash_holder = c.content % m;
+    static int home(key_type item, const fast_mod &m) {
+        return Capacity::home(Hasher::hash(uint64_t(item)), m);
+    }
+
+    static int h(int k, int j, const fast_mod &m) {
+        return Capacity::probe(k, j, m);
+    }
+
+    static bool is_live(const Holder &e, const Holder &c) {
+        return e == c && !e.mark;
+    }
+
+    static Holder empty_slot() {
+        Holder empty;
+        empty.mark = false;
+        empty.init_as_empty();
+        return empty;
+    }
+
+    // with zeroed memory and all zero empty slot pages stay untouched until first insert lands there
+    static bool needs_fill() {
+        return !(Allocator::zeroed && allocation::array<Holder, Allocator>::is_zero(empty_slot()));
+    }
+
+    static Holder* allocate(unsigned size) {
+        auto fresh = static_cast<Holder*>(Allocator::allocate(std::size_t(size)*sizeof(Holder)));
+        if (needs_fill()) {
+            std::fill_n(fresh, size, empty_slot());
+        }
+        return fresh;
+    }
+
+    // slots of a loaded snapshot go away with the mapping
+    void deallocate(Holder *slots, unsigned size) {
+        if (slots && !(mapped && mapped->contains(slots))) {
+            Allocator::deallocate(slots, std::size_t(size)*sizeof(Holder));
+        }
+    }
+
+    // tombstones are skipped, stops on live c or empty slot, returns -1 when probe sequence is exhausted
+    int process_search__true(const Holder *slots, const fast_mod &m, Holder &c) const {
+        return process_search__true(slots, m, c, home(c.content, m));
+    }
+
+    int process_search__true(const Holder *slots, const fast_mod &m, Holder &c, const int hash_holder) const {
+        const int limit = m.divisor/2;
         auto j = 0;
         auto i = hash_holder;
 
-        while ( !(table[i] == c) && (!table[i].is_empty())) {
-            j++;
+        while ( !is_live(slots[i], c) && (!slots[i].is_empty())) {
+            if (++j > limit) {
+                return -1;
+            }
             i = h(hash_holder, j, m);
             collisions++;
         }
         return i;
     }
 
-    int process_search__false(Holder &c) const {
-        const int m = capacity();
-        const int hash_holder = Holder::hash(c, m);
+    // slot of live c if present, otherwise the first tombstone or empty slot on its probe sequence
+    int process_search__false(const Holder *slots, const fast_mod &m, Holder &c) const {
+        const int limit = m.divisor/2;
+        const int hash_holder = home(c.content, m);
         auto j = 0;
         auto i = h(hash_holder, j, m);
+        auto reusable = -1;
 
-        while ( !(table[i] == c) && (!table[i].is_empty()) && !table[i].mark) {
-            j++;
+        while ( !is_live(slots[i], c) && (!slots[i].is_empty())) {
+            if (slots[i].mark && reusable < 0) {
+                reusable = i;
+            }
+            if (++j > limit) {
+                return reusable;
+            }
             i = h(hash_holder, j, m);
         }
-        return i;
+        return (!slots[i].is_empty() || reusable < 0)? i : reusable;
+    }
+
+    // slots below rehash_index were already moved to table
+    int old_search(Holder &c) const {
+        auto i = process_search__true(old_table, old_modulo, c);
+        return (i >= int(rehash_index) && !old_table[i].is_empty())? i : -1;
+    }
+
+    void update_thresholds() {
+        grow_threshold = unsigned(max_load_factor*capacity());
+        prepare_threshold = grow_threshold - grow_threshold/8;
+        compaction_threshold = unsigned(max_tombstone_ratio*capacity());
+    }
+
+    /* Drops tombstones without allocating. Live entries are flagged as pending (mark is free once
+     * tombstones are emptied) and each one is moved to the first empty or pending slot of its probe
+     * sequence. A pending occupant of that slot is swapped out and placed next, so every step settles
+     * one entry and already settled ones never move again.
+     */
+    void compact() {
+        compaction_counter++;
+        const auto &m = modulo;
+        const int size = capacity();
+        for (auto i = 0; i < size; i++) {
+            auto &e = table[i];
+            if (e.mark) {
+                e.mark = false;
+                e.init_as_empty();
+            } else if (!e.is_empty()) {
+                e.mark = true;
+            }
+        }
+        for (auto i = 0; i < size; i++) {
+            while (table[i].mark) {
+                const int hash_holder = home(table[i].content, m);
+                auto j = 0;
+                auto target = hash_holder;
+                while (!table[target].is_empty() && !table[target].mark) {
+                    j++;
+                    assert(j <= size/2);
+                    target = h(hash_holder, j, m);
+                }
+                table[i].mark = false;
+                if (target == i) {
+                    break;
+                }
+                std::swap(table[i], table[target]);
+            }
+        }
+        tombstones = 0;
+        // erased keys can't be removed from filter one by one
+        filter.clear();
+        for (auto i = 0; i < size; i++) {
+            if (!table[i].is_empty()) {
+                filter.insert(uint64_t(table[i].content));
+            }
+        }
+    }
+
+    /* Next table is allocated at prepare_threshold and filled with empty slots fill_step_size at a time,
+     * so that it is ready when grow() swaps it in and no single operation fills a whole table.
+     */
+    void prepare() {
+        // tombstones stay behind in the old table, with few live keys capacity stays the same
+        next_capacity = (n >= grow_threshold/2)? Capacity::next(_capacity) : _capacity;
+        next_table = static_cast<Holder*>(Allocator::allocate(std::size_t(next_capacity)*sizeof(Holder)));
+        next_filled = needs_fill()? 0 : next_capacity;
+        fill_step_size = next_capacity/std::max(1u, grow_threshold - std::min(grow_threshold, n + tombstones)) + 1;
+    }
+
+    void fill(unsigned steps) {
+        const auto last = std::min(next_filled + steps, next_capacity);
+        std::fill(next_table + next_filled, next_table + last, empty_slot());
+        next_filled = last;
+    }
+
+    /* migrate() and fill() below do nothing on the usual path, both are over by the time insert
+     * reaches grow_threshold. They finish the work at once only when insert ran out of probe
+     * sequence before that.
+     */
+    void grow() {
+        if (old_table) {
+            migrate(old_capacity);
+        }
+        if (!next_table) {
+            prepare();
+        }
+        fill(next_capacity);
+        rehash_counter++;
+        old_table = table;
+        old_capacity = _capacity;
+        old_modulo = modulo;
+        rehash_index = 0;
+        tombstones = 0;
+        table = std::exchange(next_table, nullptr);
+        _capacity = next_capacity;
+        modulo = fast_mod(_capacity);
+        update_thresholds();
+        old_filter = std::move(filter);
+        filter = Filter(grow_threshold);
+        // old slots are moved before the next table is prepared
+        migrate_step_size = old_capacity/std::max(1u, prepare_threshold - std::min(prepare_threshold, n)) + 1;
+    }
+
+    void rehash_step() {
+        if (old_table) {
+            migrate(migrate_step_size);
+        }
+        if (next_table && next_filled < next_capacity) {
+            fill(fill_step_size);
+        }
     }
 
+    // at most migrate_step_size old slots per operation, so migration is over before next table is prepared
+    void migrate(unsigned steps) {
+        auto last = std::min(rehash_index + steps, old_capacity);
+        for (; rehash_index < last; rehash_index++) {
+            auto &e = old_table[rehash_index];
+            if (!e.is_empty() && !e.mark) {
+                auto i = process_search__false(table, modulo, e);
+                assert(i >= 0);
+                if (table[i].mark) {
+                    tombstones--;
+                }
+                table[i] = e;
+                filter.insert(uint64_t(e.content));
+            }
+        }
+        if (rehash_index == old_capacity) {
+            deallocate(old_table, old_capacity);
+            old_table = nullptr;
+            old_capacity = 0;
+            old_filter = Filter(0);
+        }
+    }
+
+    constexpr static unsigned max_prefetch_group = 64;
+
     unsigned n = 0;
     unsigned _capacity = 0;
+    float max_load_factor;
+    float max_tombstone_ratio;
+    unsigned grow_threshold = 0;
+    unsigned prepare_threshold = 0;
+    unsigned compaction_threshold = 0;
+    unsigned tombstones = 0;
     Holder *table = nullptr;
+    fast_mod modulo;
+    Holder *old_table = nullptr;
+    unsigned old_capacity = 0;
+    fast_mod old_modulo;
+    unsigned rehash_index = 0;
+    unsigned migrate_step_size = 4;
+    Holder *next_table = nullptr;
+    unsigned next_capacity = 0;
+    unsigned next_filled = 0;
+    unsigned fill_step_size = 0;
+    Filter filter;
+    Filter old_filter;
+    std::unique_ptr<snapshot::file> mapped;
 };
 
-}
+// Keys together with empty/tombstone sentinels sit in one dense array and values in a parallel one,
+// so probing walks only key cache lines and the value line is fetched once the key matched.
+template<class K = int, class V = int>
+class map {
+    static_assert(std::is_integral_v<K>);
+public:
+    map(const map&) = delete;
+    map& operator=(const map&) = delete;
+
+    using key_type = K;
+    using mapped_type = V;
+    map(unsigned size, float load_factor = 0.75f)
+        : _capacity(size), max_load_factor(load_factor) {
+        // best speed when capacity is prime
+        assert(max_load_factor > 0.0f && max_load_factor < 1.0f);
+        allocate();
+    }
 
+    ~map() {
+        delete[] values;
+        delete[] keys;
+    }
+
+    void insert(K key, V value) {
+        assert(key != empty && key != tombstone);
+        if (n + tombstones >= grow_threshold) {
+            // mostly tombstones - rebuild at the same capacity
+            rehash(n >= grow_threshold/2);
+        }
+        auto i = process_search__false(key);
+        while (i < 0) {
+            rehash(true);
+            i = process_search__false(key);
+        }
+        if (keys[i] == key) {
+            values[i] = std::move(value);
+            return;
+        }
+        if (keys[i] == tombstone) {
+            tombstones--;
+        }
+        keys[i] = key;
+        values[i] = std::move(value);
+        n++;
+    }
+
+    void erase(K key) {
+        auto i = process_search__true(key);
+        if (i >= 0 && keys[i] == key) {
+            keys[i] = tombstone;
+            n--;
+            tombstones++;
+        }
+    }
+
+    V* find(K key) {
+        auto i = process_search__true(key);
+        return (i >= 0 && keys[i] == key)? &values[i] : nullptr;
+    }
+
+    const V* find(K key) const {
+        return const_cast<map*>(this)->find(key);
+    }
 
+    bool search(K key) const {
+        return find(key) != nullptr;
+    }
+
+    unsigned size() const {
+        return n;
+    }
+
+    unsigned capacity() const {
+        return _capacity;
+    }
+
+    mutable unsigned collisions = 0;
+    unsigned rehash_counter = 0;
+private:
+    static int hash(K key, int m) {
+        return static_cast<std::make_unsigned_t<K>>(key) % m;
+    }
+
+    void allocate() {
+        keys = new K[capacity()];
+        values = new V[capacity()];
+        std::fill_n(keys, capacity(), empty);
+        modulo = fast_mod(capacity());
+        grow_threshold = unsigned(max_load_factor*capacity());
+    }
+
+    // tombstones are skipped, returns -1 when probe sequence is exhausted
+    int process_search__true(K key) const {
+        const int m = capacity();
+        const int hash_key = hash(key, m);
+        auto j = 0;
+        auto i = hash_key;
+
+        while (keys[i] != key && keys[i] != empty) {
+            if (++j > m/2) {
+                return -1;
+            }
+            i = prime_capacity::probe(hash_key, j, modulo);
+            collisions++;
+        }
+        return i;
+    }
+
+    // slot of key if present, otherwise the first tombstone or empty slot on its probe sequence
+    int process_search__false(K key) const {
+        const int m = capacity();
+        const int hash_key = hash(key, m);
+        auto j = 0;
+        auto i = hash_key;
+        auto reusable = -1;
+
+        while (keys[i] != key && keys[i] != empty) {
+            if (keys[i] == tombstone && reusable < 0) {
+                reusable = i;
+            }
+            if (++j > m/2) {
+                return reusable;
+            }
+            i = prime_capacity::probe(hash_key, j, modulo);
+        }
+        return (keys[i] == key || reusable < 0)? i : reusable;
+    }
+
+    void rehash(bool grow) {
+        rehash_counter++;
+        auto old_keys = keys;
+        auto old_values = values;
+        auto old_capacity = _capacity;
+        if (grow) {
+            _capacity = prime(2*_capacity);
+        }
+        allocate();
+        n = 0;
+        tombstones = 0;
+        for (auto i = 0u; i < old_capacity; i++) {
+            if (old_keys[i] != empty && old_keys[i] != tombstone) {
+                auto j = process_search__false(old_keys[i]);
+                assert(j >= 0);
+                keys[j] = old_keys[i];
+                values[j] = std::move(old_values[i]);
+                n++;
+            }
+        }
+        delete[] old_values;
+        delete[] old_keys;
+    }
+
+    constexpr static K empty = K(-1);
+    constexpr static K tombstone = K(-2);
+
+    unsigned n = 0;
+    unsigned tombstones = 0;
+    unsigned _capacity = 0;
+    fast_mod modulo;
+    float max_load_factor;
+    unsigned grow_threshold = 0;
+    K *keys = nullptr;
+    V *values = nullptr;
+};
+
+/* Robin Hood mode: linear probing where an insert takes the slot of any entry that sits closer
+ * to its home than the inserted key. Every slot keeps its probe distance, so a lookup stops
+ * as soon as it has walked further than the entry it is looking at - a miss costs about as
+ * much as a hit even at high alpha. Erase shifts the following entries one slot back instead
+ * of leaving tombstones.
+ */
+template<class T = int, class Hasher = hashers::identity>
+class robin_hood_set {
+    static_assert(std::is_integral_v<T>);
+public:
+    robin_hood_set(const robin_hood_set&) = delete;
+    robin_hood_set& operator=(const robin_hood_set&) = delete;
+
+    using key_type = T;
+    robin_hood_set(unsigned size, float load_factor = 0.9f)
+        : _capacity(size), max_load_factor(load_factor) {
+        // best speed when capacity is prime
+        assert(max_load_factor > 0.0f && max_load_factor < 1.0f);
+        allocate();
+    }
+
+    ~robin_hood_set() {
+        delete[] table;
+    }
+
+    void insert(T item) {
+        if (n >= grow_threshold) {
+            rehash();
+        }
+        auto i = home(item);
+        slot carried = {item, 1};
+        auto displaced = false;
+        while (table[i].distance != 0) {
+            if (!displaced && table[i].distance == carried.distance && table[i].content == item) {
+                return;
+            }
+            if (table[i].distance < carried.distance) {
+                // item is not in the table - it would have been found before such a slot
+                std::swap(carried, table[i]);
+                displaced = true;
+            }
+            i = next(i);
+            if (++carried.distance == max_distance) {
+                // the carried entry is the only one outside the table, it goes back once capacity doubled
+                rehash();
+                insert(carried.content);
+                return;
+            }
+        }
+        table[i] = carried;
+        n++;
+    }
+
+    void erase(T item) {
+        auto i = process_search(item);
+        if (i < 0) {
+            return;
+        }
+        // backward shift: followers that are not at home move one slot closer to it
+        for (auto j = next(i); table[j].distance > 1; i = j, j = next(j)) {
+            table[i] = table[j];
+            table[i].distance--;
+        }
+        table[i].distance = 0;
+        n--;
+    }
+
+    bool search(T item) const {
+        return process_search(item) >= 0;
+    }
+
+    unsigned size() const {
+        return n;
+    }
+
+    unsigned capacity() const {
+        return _capacity;
+    }
+
+    mutable unsigned collisions = 0;
+    unsigned rehash_counter = 0;
+private:
+    // distance is 1 for an entry in its home slot, 0 marks an empty slot
+    struct slot {
+        T content;
+        uint8_t distance;
+    } __attribute__((packed));
+
+    constexpr static unsigned max_distance = 255;
+
+    unsigned home(T item) const {
+        return modulo(uint32_t(Hasher::hash(uint64_t(item))));
+    }
+
+    unsigned next(unsigned i) const {
+        return (i + 1 == _capacity)? 0 : i + 1;
+    }
+
+    // entries are ordered by distance, so passing one that is closer to its home than item means a miss
+    int process_search(T item) const {
+        auto i = home(item);
+        for (auto distance = 1u; table[i].distance >= distance; distance++) {
+            if (table[i].content == item) {
+                return int(i);
+            }
+            i = next(i);
+            collisions++;
+        }
+        return -1;
+    }
+
+    void allocate() {
+        table = new slot[_capacity];
+        for (auto i = 0u; i < _capacity; i++) {
+            table[i].distance = 0;
+        }
+        modulo = fast_mod(_capacity);
+        grow_threshold = unsigned(max_load_factor*_capacity);
+    }
+
+    void rehash() {
+        rehash_counter++;
+        auto old_table = table;
+        auto old_capacity = _capacity;
+        _capacity = prime(2*_capacity);
+        allocate();
+        const auto count = n;
+        n = 0;
+        for (auto i = 0u; i < old_capacity; i++) {
+            if (old_table[i].distance != 0) {
+                insert(old_table[i].content);
+            }
+        }
+        assert(n == count);
+        (void)count;
+        delete[] old_table;
+    }
+
+    unsigned n = 0;
+    unsigned _capacity;
+    float max_load_factor;
+    unsigned grow_threshold = 0;
+    slot *table = nullptr;
+    fast_mod modulo;
+};
+
+/* Fixed capacity set of int/int64 keys for many threads at once. A slot goes from empty to a key
+ * exactly once (compare-exchange), so lookups are plain acquire loads along the probe sequence and
+ * never wait for anything. There is no erase and no growth: insert returns false when the key is
+ * already there or its probe sequence is full. Nothing shared is written on lookup, collisions
+ * are counted only into a caller provided (thread local) counter.
+ */
+template<class T = int, class Hasher = hashers::identity>
+class concurrent_set {
+    static_assert(std::is_integral_v<T> && std::atomic<T>::is_always_lock_free);
+public:
+    concurrent_set(const concurrent_set&) = delete;
+    concurrent_set& operator=(const concurrent_set&) = delete;
+
+    using key_type = T;
+    explicit concurrent_set(unsigned size)
+        : _capacity(size), modulo(size), slots(new std::atomic<T>[size]) {
+        // best speed when capacity is prime
+        for (auto i = 0u; i < _capacity; i++) {
+            slots[i].store(empty, std::memory_order_relaxed);
+        }
+    }
+
+    ~concurrent_set() {
+        delete[] slots;
+    }
+
+    bool insert(T item) {
+        assert(item != empty);
+        const int hash_item = home(item);
+        auto i = hash_item;
+        for (auto j = 0; j <= limit(); i = prime_capacity::probe(hash_item, ++j, modulo)) {
+            auto current = slots[i].load(std::memory_order_acquire);
+            if (current == empty
+                && slots[i].compare_exchange_strong(current, item, std::memory_order_release, std::memory_order_acquire)) {
+                n.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            // lost the race or slot taken earlier, current holds the winner
+            if (current == item) {
+                return false;
+            }
+        }
+        return false;
+    }
+
+    bool search(T item) const {
+        auto collisions = 0u;
+        return search(item, collisions);
+    }
+
+    bool search(T item, unsigned &collisions) const {
+        const int hash_item = home(item);
+        auto i = hash_item;
+        for (auto j = 0; j <= limit(); i = prime_capacity::probe(hash_item, ++j, modulo)) {
+            const auto current = slots[i].load(std::memory_order_acquire);
+            if (current == empty) {
+                return false;
+            }
+            if (current == item) {
+                return true;
+            }
+            collisions++;
+        }
+        return false;
+    }
+
+    unsigned size() const {
+        return n.load(std::memory_order_relaxed);
+    }
+
+    unsigned capacity() const {
+        return _capacity;
+    }
+
+private:
+    constexpr static T empty = T(-1);
+
+    int home(T item) const {
+        return prime_capacity::home(Hasher::hash(uint64_t(item)), modulo);
+    }
+
+    int limit() const {
+        return int(_capacity/2);
+    }
+
+    const unsigned _capacity;
+    const fast_mod modulo;
+    std::atomic<T> *const slots;
+    // on its own cache line, so that inserts bumping it don't invalidate the fields read by lookups
+    alignas(64) std::atomic<unsigned> n = 0;
+};
+
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <span>
+#include <cassert>
+#include <cstdint>
+#include <immintrin.h>
+#include "hashers.hh"
+
+namespace sharded {
+
+/* test and test-and-set, waiters spin on a plain load so the line stays shared until unlock.
+ * After a while they yield, a holder preempted by more threads than cores is not waited out.
+ */
+class spinlock {
+public:
+    void lock() noexcept {
+        while (locked.exchange(true, std::memory_order_acquire)) {
+            for (auto spins = 0u; locked.load(std::memory_order_relaxed); spins++) {
+                if (spins < max_spins) {
+                    _mm_pause();
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        }
+    }
+
+    bool try_lock() noexcept {
+        return !locked.load(std::memory_order_relaxed) && !locked.exchange(true, std::memory_order_acquire);
+    }
+
+    void unlock() noexcept {
+        locked.store(false, std::memory_order_release);
+    }
+
+private:
+    constexpr static unsigned max_spins = 64;
+    std::atomic<bool> locked = false;
+};
+
+/* Keys are spread over N shards, each one a single threaded Inner set (open_addressing::set,
+ * cuckoo::set, ...) behind its own Lock. Every shard is a separate cache line aligned allocation,
+ * so threads working on different shards never share a line. Shard of a key comes from the top
+ * bits of murmur3 - inner tables hash the low bits, so both stay uniform.
+ * With a shared Lock (std::shared_mutex) lookups take it shared, but only when Inner::search is
+ * const - open_addressing::set::search advances incremental growth and has to be exclusive.
+ * A const search still must not write anything (cuckoo::set), tables counting collisions
+ * in a mutable member need an exclusive Lock.
+ * Batch calls group keys by shard first and take each lock once per batch.
+ * One shard with std::mutex is the global lock baseline.
+ */
+template<class Inner, class Lock = spinlock>
+class set {
+public:
+    set(const set&) = delete;
+    set& operator=(const set&) = delete;
+
+    using key_type = typename Inner::key_type;
+
+    // every shard gets Inner(args...)
+    template<class... Args>
+    explicit set(unsigned shards_number, const Args&... args) {
+        assert(shards_number > 0);
+        for (auto i = 0u; i < shards_number; i++) {
+            shards.push_back(std::make_unique<shard>(args...));
+        }
+    }
+
+    void insert(key_type item) {
+        auto &s = shard_of(item);
+        std::lock_guard guard(s.lock);
+        s.inner.insert(item);
+    }
+
+    void erase(key_type item) {
+        auto &s = shard_of(item);
+        std::lock_guard guard(s.lock);
+        s.inner.erase(item);
+    }
+
+    bool search(key_type item) {
+        auto &s = shard_of(item);
+        if constexpr (shared_search) {
+            std::shared_lock guard(s.lock);
+            return std::as_const(s.inner).search(item);
+        } else {
+            std::lock_guard guard(s.lock);
+            return s.inner.search(item);
+        }
+    }
+
+    void insert_many(std::span<const key_type> items) {
+        for_each_shard(items, [&](shard &s, std::span<const unsigned> positions) {
+            std::lock_guard guard(s.lock);
+            for (auto k : positions) {
+                s.inner.insert(items[k]);
+            }
+        });
+    }
+
+    void erase_many(std::span<const key_type> items) {
+        for_each_shard(items, [&](shard &s, std::span<const unsigned> positions) {
+            std::lock_guard guard(s.lock);
+            for (auto k : positions) {
+                s.inner.erase(items[k]);
+            }
+        });
+    }
+
+    // found[i] tells if items[i] is present, returns number of hits
+    unsigned search_many(std::span<const key_type> items, std::span<bool> found) {
+        assert(found.size() >= items.size());
+        auto hits = 0u;
+        for_each_shard(items, [&](shard &s, std::span<const unsigned> positions) {
+            auto lookup = [&](auto &inner) {
+                for (auto k : positions) {
+                    found[k] = inner.search(items[k]);
+                    hits += found[k];
+                }
+            };
+            if constexpr (shared_search) {
+                std::shared_lock guard(s.lock);
+                lookup(std::as_const(s.inner));
+            } else {
+                std::lock_guard guard(s.lock);
+                lookup(s.inner);
+            }
+        });
+        return hits;
+    }
+
+    unsigned size() {
+        auto result = 0u;
+        for (auto &s : shards) {
+            std::lock_guard guard(s->lock);
+            result += s->inner.size();
+        }
+        return result;
+    }
+
+    unsigned shards_number() const {
+        return shards.size();
+    }
+
+private:
+    struct alignas(64) shard {
+        template<class... Args>
+        explicit shard(const Args&... args) : inner(args...) {}
+
+        Lock lock;
+        Inner inner;
+    };
+
+    constexpr static bool shared_search = requires(Lock &lock, const Inner &inner, key_type item) {
+        lock.lock_shared();
+        inner.search(item);
+    };
+
+    unsigned shard_index(key_type item) const {
+        const auto hash = hashers::murmur3::hash(uint64_t(item));
+        return unsigned(((hash >> 32)*shards.size()) >> 32);
+    }
+
+    shard& shard_of(key_type item) {
+        return *shards[shard_index(item)];
+    }
+
+    // counting sort of positions by shard, then visit(shard, positions of its items) for every non empty shard
+    template<class Visit>
+    void for_each_shard(std::span<const key_type> items, Visit visit) {
+        const auto n = shards.size();
+        // reused between calls, batch calls don't allocate
+        thread_local std::vector<unsigned> index, begin, next, order;
+        index.resize(items.size());
+        order.resize(items.size());
+        begin.assign(n + 1, 0u);
+        for (auto k = 0u; k < items.size(); k++) {
+            index[k] = shard_index(items[k]);
+            begin[index[k] + 1]++;
+        }
+        for (auto i = 0u; i < n; i++) {
+            begin[i + 1] += begin[i];
+        }
+        next = begin;
+        for (auto k = 0u; k < items.size(); k++) {
+            order[next[index[k]]++] = k;
+        }
+        for (auto i = 0u; i < n; i++) {
+            if (begin[i] != begin[i + 1]) {
+                visit(*shards[i], std::span<const unsigned>(order.data() + begin[i], begin[i + 1] - begin[i]));
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<shard>> shards;
+};
+
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <span>
+#include <string>
+#include <stdexcept>
+#include <typeinfo>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Snapshot file of a table: one page of header followed by up to two raw slot arrays, each one at
+ * a page aligned offset so a mapping of the file can be used as the table in place. Loading is an mmap,
+ * pages come in on first lookup instead of re-inserting every key.
+ * layout is a hash of the mangled names of the types that decide slot contents and key placement,
+ * a file is accepted only by the same instantiation (allocation policy and filter don't matter).
+ */
+namespace snapshot {
+
+// read_only: shared mapping, only lookups allowed. copy_on_write: private mapping, changes stay in memory
+enum class mode {
+    read_only, copy_on_write
+};
+
+constexpr uint32_t version = 1;
+constexpr std::size_t page = 4096;
+
+struct header {
+    char magic[8];
+    uint32_t version;
+    uint32_t slot_size;
+    uint64_t layout;
+    uint64_t count;
+    // open addressing: slots; cuckoo: left and right buckets
+    uint64_t capacity[2];
+    // hash state, cuckoo: seed_state and multiply-shift a, b of the left and the right table
+    uint64_t seed[5];
+    uint64_t offset[2];
+    uint64_t bytes[2];
+    uint32_t tombstones;
+    float load_factor;
+    float tombstone_ratio;
+    uint32_t stashed;
+    uint64_t stash[16];
+};
+static_assert(sizeof(header) <= page);
+
+constexpr char magic[8] = {'f', 's', 't', 'd', 's', 'n', 'a', 'p'};
+
+template<class... Types>
+uint64_t layout() noexcept {
+    // FNV-1a
+    auto hash = UINT64_C(0xcbf29ce484222325);
+    for (auto name : {typeid(Types).name()...}) {
+        for (; *name; name++) {
+            hash = (hash ^ uint8_t(*name))*UINT64_C(0x100000001b3);
+        }
+        hash = (hash ^ uint8_t(';'))*UINT64_C(0x100000001b3);
+    }
+    return hash;
+}
+
+inline std::size_t round_up(std::size_t bytes) noexcept {
+    return (bytes + page - 1) & ~(page - 1);
+}
+
+/* Writes header and sections to path + ".tmp" and renames it over path, so a reader never maps
+ * a half written file. Offsets and sizes of sections are filled in here.
+ */
+inline void write(const std::string &path, header head, std::span<const std::byte> first,
+                  std::span<const std::byte> second = {}) {
+    std::memcpy(head.magic, magic, sizeof(magic));
+    head.version = version;
+    head.offset[0] = page;
+    head.bytes[0] = first.size();
+    head.offset[1] = second.empty()? 0 : page + round_up(first.size());
+    head.bytes[1] = second.size();
+    const auto tmp = path + ".tmp";
+    auto out = std::fopen(tmp.c_str(), "wb");
+    if (!out) {
+        throw std::runtime_error("snapshot: can't create " + tmp);
+    }
+    static const std::byte zeros[page] = {};
+    auto ok = std::fwrite(&head, sizeof(head), 1, out) == 1 && std::fwrite(zeros, page - sizeof(head), 1, out) == 1;
+    ok = ok && std::fwrite(first.data(), 1, first.size(), out) == first.size();
+    if (!second.empty()) {
+        const auto padding = round_up(first.size()) - first.size();
+        ok = ok && std::fwrite(zeros, 1, padding, out) == padding;
+        ok = ok && std::fwrite(second.data(), 1, second.size(), out) == second.size();
+    }
+    ok = (std::fclose(out) == 0) && ok;
+    if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        throw std::runtime_error("snapshot: can't write " + path);
+    }
+}
+
+/* Mapping of a whole snapshot file, checked against expected slot size and layout and against what
+ * the table trusts once loaded: `sections` non-empty slot arrays of capacity[i] slots lying inside
+ * the file, at most `max_stashed` stashed keys and no more keys than slots*keys_per_slot + stashed.
+ */
+class file {
+public:
+    file(const std::string &path, mode m, uint32_t slot_size, uint64_t layout, unsigned sections = 1,
+         uint64_t keys_per_slot = 1, uint32_t max_stashed = 0) {
+        auto fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("snapshot: can't open " + path);
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || std::size_t(st.st_size) < page) {
+            close(fd);
+            throw std::runtime_error("snapshot: " + path + " is too short");
+        }
+        size = std::size_t(st.st_size);
+        const auto protection = (m == mode::read_only)? PROT_READ : PROT_READ | PROT_WRITE;
+        const auto flags = (m == mode::read_only)? MAP_SHARED : MAP_PRIVATE;
+        base = static_cast<std::byte*>(mmap(nullptr, size, protection, flags, fd, 0));
+        close(fd);
+        if (base == MAP_FAILED) {
+            base = nullptr;
+            throw std::runtime_error("snapshot: can't map " + path);
+        }
+        if (!valid(slot_size, layout, sections, keys_per_slot, max_stashed)) {
+            munmap(base, size);
+            base = nullptr;
+            throw std::runtime_error("snapshot: " + path + " has wrong version, layout or size");
+        }
+    }
+
+    file(const file&) = delete;
+    file& operator=(const file&) = delete;
+
+    ~file() {
+        if (base) {
+            munmap(base, size);
+        }
+    }
+
+    const header& head() const noexcept {
+        return *reinterpret_cast<const header*>(base);
+    }
+
+    template<class T>
+    T* section(unsigned i) const noexcept {
+        return reinterpret_cast<T*>(base + head().offset[i]);
+    }
+
+    bool contains(const void *p) const noexcept {
+        auto b = static_cast<const std::byte*>(p);
+        return b >= base && b < base + size;
+    }
+
+private:
+    bool valid(uint32_t slot_size, uint64_t layout, unsigned sections, uint64_t keys_per_slot,
+               uint32_t max_stashed) const noexcept {
+        const auto &h = head();
+        if (std::memcmp(h.magic, magic, sizeof(magic)) != 0 || h.version != version || h.slot_size != slot_size
+            || h.layout != layout || h.stashed > max_stashed) {
+            return false;
+        }
+        auto slots = uint64_t(0);
+        for (auto i = 0u; i < 2; i++) {
+            // capacities are unsigned in the tables, so bytes can't overflow here
+            const auto expected = (i < sections) == (h.capacity[i] != 0) && h.capacity[i] <= UINT32_MAX
+                && h.bytes[i] == h.capacity[i]*slot_size && h.offset[i] % page == 0 && (h.bytes[i] == 0 || h.offset[i] >= page)
+                && h.bytes[i] <= size && h.offset[i] <= size - h.bytes[i];
+            if (!expected) {
+                return false;
+            }
+            slots += h.capacity[i];
+        }
+        return h.count <= slots*keys_per_slot + h.stashed;
+    }
+
+    std::byte *base = nullptr;
+    std::size_t size = 0;
+};
+
+}
@@ -1,7 +1,17 @@
 ﻿#include "cuckoo_hashmap.hh"
 #include "open_addressing_hashmap.hh"
+#include "swiss_hashmap.hh"
+#include "hopscotch_hashmap.hh"
+#include "sharded_hashmap.hh"
+#include "frozen_set.hh"
 #include <ctime>
+#include <unordered_map>
+#include <memory>
+#include <thread>
 #include <iostream>
+#include <fstream>
+#include <string>
+#include <filesystem>
 #include <cstdlib>
 #include <unistd.h>
 #include <cstring>
@@ -45,7 +55,7 @@ static void perf_disable(int fd) {
     ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
 }
 
-int fd1, fd2, fd3;
+int fd1, fd2, fd3, fd4;
 
 static void perf_init() {
     perf_event_attr pe;
@@ -64,9 +74,15 @@ static void perf_init() {
 
     pe.config = PERF_COUNT_HW_CACHE_MISSES;
     fd3 = perf_open(&pe);
+
+    // page walks are what huge pages save, cache-misses alone don't show them
+    pe.type = PERF_TYPE_HW_CACHE;
+    pe.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    fd4 = perf_open(&pe);
 }
 
 static void perf_close() {
+    close(fd4);
     close(fd3);
     close(fd2);
     close(fd1);
@@ -99,6 +115,7 @@ namespace raw_array_access {
        perf_enable(fd1);
        perf_enable(fd2);
        perf_enable(fd3);
+       perf_enable(fd4);
    }
    auto found = 0u;
    for (auto n : lookups_set) {
@@ -108,6 +125,7 @@ namespace raw_array_access {
        perf_disable(fd1);
        perf_disable(fd2);
        perf_disable(fd3);
+       perf_disable(fd4);
    }
 
    auto t1 = realtime_now();
@@ -119,12 +137,13 @@ namespace raw_array_access {
           << "  alpha = " << alpha << "  time = " << time_ms << " ms     latency of search op = "
           << latency << " ns     throughput = " << throughput << " MB/s found = " << found << std::endl;
    if constexpr (stats) {
-       long long count1, count2, count3;
+       long long count1, count2, count3, count4;
        read(fd1, &count1, sizeof(count1));
        read(fd2, &count2, sizeof(count2));
        read(fd3, &count3, sizeof(count3));
+       read(fd4, &count4, sizeof(count4));
        std::cout << "Used " << count1 << " instructions     " << count2 << " cache-references     " <<
-                     count3 << " cache-misses" << std::endl;
+                     count3 << " cache-misses     " << count4 << " dTLB-load-misses" << std::endl;
        perf_close();
    }
 }
@@ -164,6 +183,131 @@ static void benchmark(auto capacity, auto operations_number) {
 
 }
 }
+namespace open_addressing_map_benchmarks {
+
+static void benchmark(auto capacity, auto operations_number) {
+    constexpr auto uniwersum_size = 2'000'000'000u;
+    open_addressing::map<int, int> hashmap(capacity);
+    std::unordered_map<int, int> stl_map;
+    stl_map.reserve(capacity);
+    srand(time(nullptr));
+    std::vector<int> lookups_set;
+    for (auto i = 0u; i < operations_number; i++) {
+        auto operation = get_operation();
+        auto item = rand()%uniwersum_size;
+
+        if (operation == 'I') {
+            hashmap.insert(item, item);
+            stl_map[item] = item;
+        } else {
+            lookups_set.push_back(item);
+        }
+    }
+    auto t0 = realtime_now();
+    auto found = 0u;
+    for (auto n : lookups_set) {
+        auto value = hashmap.find(n);
+        found += value? static_cast<unsigned>(*value == n) : 0u;
+    }
+    auto t1 = realtime_now();
+    auto stl_found = 0u;
+    for (auto n : lookups_set) {
+        auto it = stl_map.find(n);
+        stl_found += (it != stl_map.end())? static_cast<unsigned>(it->second == n) : 0u;
+    }
+    auto t2 = realtime_now();
+    auto time_ms = (t1 - t0)/1000000;
+    auto stl_time_ms = (t2 - t1)/1000000;
+    auto alpha = operations_number*1.0f/(2*capacity);
+    auto latency = 1'000'000.0f*time_ms/float(operations_number);
+    auto stl_latency = 1'000'000.0f*stl_time_ms/float(operations_number);
+    std::cout << "Test only S:    searches = " << lookups_set.size() << " alpha = " << alpha << " rehashes = "
+              << hashmap.rehash_counter << " colisions/search = " << 1.0f*hashmap.collisions/(lookups_set.size())
+              << " time = " << time_ms << " ms     latency of search op = " << latency << " ns   found = " << found
+              << "     std::unordered_map time = " << stl_time_ms << " ms     latency of search op = "
+              << stl_latency << " ns   found = " << stl_found << std::endl;
+}
+}
+
+namespace open_addressing_growth_benchmarks {
+
+static void benchmark(unsigned capacity, unsigned inserts_number) {
+    constexpr auto uniwersum_size = 2'000'000'000u;
+    open_addressing::set<> hashmap(capacity);
+    srand(time(nullptr));
+    std::vector<int> inserts_set;
+    for (auto i = 0u; i < inserts_number; i++) {
+        inserts_set.push_back(rand()%uniwersum_size);
+    }
+    std::vector<uint64_t> latencies;
+    latencies.reserve(inserts_number);
+    auto t0 = realtime_now();
+    for (auto n : inserts_set) {
+        auto begin = realtime_now();
+        hashmap.insert(n);
+        latencies.push_back(realtime_now() - begin);
+    }
+    auto t1 = realtime_now();
+    auto time_ms = (t1 - t0)/1000000;
+    std::sort(latencies.begin(), latencies.end());
+    auto p99 = latencies[latencies.size()*99/100];
+    auto max = latencies.back();
+    auto alpha = hashmap.size()*1.0f/hashmap.capacity();
+    std::cout << "Test only I:    rehashes = " << hashmap.rehash_counter << " inserts = " << inserts_number
+              << "   capacities = " << capacity << "," << hashmap.capacity() << "  alpha = " << alpha << "  time = "
+              << time_ms << " ms     p99 latency of insert op = " << p99 << " ns     max latency of insert op = "
+              << max << " ns" << std::endl;
+}
+}
+
+namespace open_addressing_churn_benchmarks {
+
+/* Keeps size ~ alpha*capacity while every round erases a random live key and inserts a new one.
+ * Without real tombstones and compaction lookup cost keeps growing round after round.
+ */
+static void benchmark(unsigned capacity, float alpha, unsigned rounds, unsigned churn_per_round) {
+    constexpr auto uniwersum_size = 2'000'000'000u;
+    constexpr auto lookups_number = 1'000'000u;
+    open_addressing::set<> hashmap(capacity);
+    srand(time(nullptr));
+    std::vector<int> live;
+    while (live.size() < unsigned(alpha*capacity)) {
+        int item = rand()%uniwersum_size;
+        if (!hashmap.search(item)) {
+            hashmap.insert(item);
+            live.push_back(item);
+        }
+    }
+    std::vector<int> lookups_set;
+    for (auto i = 0u; i < lookups_number; i++) {
+        lookups_set.push_back(rand()%uniwersum_size);
+    }
+    auto operations = 0ull;
+    for (auto round = 0u; round < rounds; round++) {
+        for (auto i = 0u; i < churn_per_round; i++) {
+            auto &victim = live[rand()%live.size()];
+            hashmap.erase(victim);
+            victim = rand()%uniwersum_size;
+            hashmap.insert(victim);
+        }
+        operations += 2ull*churn_per_round;
+        hashmap.collisions = 0;
+        auto t0 = realtime_now();
+        auto found = 0u;
+        for (auto n : lookups_set) {
+            found += static_cast<unsigned>(hashmap.search(n));
+        }
+        auto t1 = realtime_now();
+        auto latency = (t1 - t0)*1.0f/lookups_set.size();
+        std::cout << "Test I+E churn:    operations = " << operations << " size = " << hashmap.size()
+                  << "   capacity = " << hashmap.capacity() << "  rehashes = " << hashmap.rehash_counter
+                  << "  compactions = " << hashmap.compaction_counter << "  colisions/search = "
+                  << 1.0f*hashmap.collisions/lookups_set.size() << "  latency of search op = " << latency
+                  << " ns   found = " << found << std::endl;
+    }
+}
+}
+
 /* This benchmark test only I+M.
 
   - with alpha = ~95% it's 5 collisions/op and 62 ns/op.
@@ -383,7 +527,7 @@ namespace cuckoo_hashmap_benchmarks {
 static void preliminaries() {
     auto n = 1;
     for (auto i = 0; i < 50; i++) {
-        n = cuckoo::set<>::prime(n);
+        n = prime(n);
         std::cout << n++ << " ";
     }
     std::cout << std::endl;
@@ -394,7 +538,7 @@ static void benchmark(unsigned capacity, unsigned operations_number) {
         perf_init();
     }
     constexpr auto uniwersum_size = 2'000'000'000u;
-    auto left = static_cast<unsigned>(capacity), right = cuckoo::set<>::prime(left+1);
+    auto left = static_cast<unsigned>(capacity), right = prime(left+1);
     cuckoo::set<> hashmap(left, right);
     srand(time(nullptr));
     std::vector<int> lookups_set;
@@ -413,6 +557,7 @@ static void benchmark(unsigned capacity, unsigned operations_number) {
         perf_enable(fd1);
         perf_enable(fd2);
         perf_enable(fd3);
+        perf_enable(fd4);
     }
     auto found = 0u;
     for (auto n : lookups_set) {
@@ -422,6 +567,7 @@ static void benchmark(unsigned capacity, unsigned operations_number) {
         perf_disable(fd1);
         perf_disable(fd2);
         perf_disable(fd3);
+        perf_disable(fd4);
     }
     auto t1 = realtime_now();
     auto time_ms = (t1 - t0)/1000000;
@@ -433,74 +579,1402 @@ static void benchmark(unsigned capacity, unsigned operations_number) {
            << "   capacities = " << nleft << "," << nright << "  alpha = " << alpha << "  time = " << time_ms << " ms     latency of search op = "
            << latency << " ns   throughput = " << throughput << " MB/s   found = " << found << std::endl;
     if constexpr (stats) {
-        long long count1, count2, count3;
+        long long count1, count2, count3, count4;
         read(fd1, &count1, sizeof(count1));
         read(fd2, &count2, sizeof(count2));
         read(fd3, &count3, sizeof(count3));
+        read(fd4, &count4, sizeof(count4));
         std::cout << "Used " << count1 << " instructions     " << count2 << " cache-references     " <<
-                      count3 << " cache-misses" << std::endl;
+                      count3 << " cache-misses     " << count4 << " dTLB-load-misses" << std::endl;
         perf_close();
     }
 }
 }
 
-int main() {
-    std::cout << "Test raw access to vector as reference. WS = 2MB\n";
-    raw_array_access::benchmark(500'009, 200'000u);
-    raw_array_access::benchmark(500'009, 400'000u);
-    raw_array_access::benchmark(500'009, 600'000u);
-    raw_array_access::benchmark(500'009, 900'000u);
+namespace hopscotch_hashmap_benchmarks {
 
-    std::cout << "Test raw access to vector as reference. WS = 10MB\n";
-    raw_array_access::benchmark(2'500'009, 800'000u);
-    raw_array_access::benchmark(2'500'009, 1'800'000u);
-    raw_array_access::benchmark(2'500'009, 2'600'000u);
-    raw_array_access::benchmark(2'500'009, 3'800'000u);
+static void benchmark(unsigned capacity, unsigned operations_number) {
+    if constexpr (stats) {
+        perf_init();
+    }
+    constexpr auto uniwersum_size = 2'000'000'000u;
+    hopscotch::set<> hashmap(capacity);
+    srand(time(nullptr));
+    std::vector<int> lookups_set;
+    for (auto i = 0u; i < operations_number; i++) {
+        auto operation = get_operation();
+        int item = rand()%uniwersum_size;
 
-    std::cout << "Test raw access to vector as reference. WS = 100MB\n";
-    raw_array_access::benchmark(25'000'109, 8'000'000u);
-    raw_array_access::benchmark(25'000'109, 18'000'000u);
-    raw_array_access::benchmark(25'000'109, 26'000'000u);
-    raw_array_access::benchmark(25'000'109, 38'000'000u);
-    std::cout << std::endl;
-#if 0
-    std::cout << "OA: test only NOK lookups with almost no hits. WS = 2MB\n";
-    open_addressing_hashmap_benchmarks::benchmark(500'009, 200'000u);
-    open_addressing_hashmap_benchmarks::benchmark(500'009, 400'000u);
-    open_addressing_hashmap_benchmarks::benchmark(500'009, 600'000u);
-    open_addressing_hashmap_benchmarks::benchmark(500'009, 900'000u);
+        if (operation == 'I') {
+            hashmap.insert(item);
+        } else {
+            lookups_set.push_back(item);
+        }
+    }
+    auto t0 = realtime_now();
+    if constexpr (stats) {
+        perf_enable(fd1);
+        perf_enable(fd2);
+        perf_enable(fd3);
+        perf_enable(fd4);
+    }
+    auto found = 0u;
+    for (auto n : lookups_set) {
+        found += static_cast<unsigned>(hashmap.search(n));
+    }
+    if constexpr (stats) {
+        perf_disable(fd1);
+        perf_disable(fd2);
+        perf_disable(fd3);
+        perf_disable(fd4);
+    }
+    auto t1 = realtime_now();
+    auto time_ms = (t1 - t0)/1000000;
+    auto latency = 1'000'000.0f*time_ms/float(operations_number);
+    auto throughput = static_cast<unsigned>(1'000*4.0f/latency);
+    auto alpha = operations_number*1.0f/(2*capacity);
+    std::cout << "Test only S:    rehashes = " << hashmap.rehash_counter << " searches = " << lookups_set.size()
+              << "   capacity = " << hashmap.capacity() << "  alpha = " << alpha << " colisions/search = "
+              << 1.0f*hashmap.collisions/lookups_set.size() << "  time = " << time_ms << " ms     latency of search op = "
+              << latency << " ns   throughput = " << throughput << " MB/s   found = " << found << std::endl;
+    if constexpr (stats) {
+        long long count1, count2, count3, count4;
+        read(fd1, &count1, sizeof(count1));
+        read(fd2, &count2, sizeof(count2));
+        read(fd3, &count3, sizeof(count3));
+        read(fd4, &count4, sizeof(count4));
+        std::cout << "Used " << count1 << " instructions     " << count2 << " cache-references     " <<
+                      count3 << " cache-misses     " << count4 << " dTLB-load-misses" << std::endl;
+        perf_close();
+    }
+}
+}
 
-    std::cout << "OA: test only NOK lookups with almost no hits. WS = 10MB\n";
-    open_addressing_hashmap_benchmarks::benchmark(2'500'009, 800'000u);
-    open_addressing_hashmap_benchmarks::benchmark(2'500'009, 1'800'000u);
-    open_addressing_hashmap_benchmarks::benchmark(2'500'009, 2'600'000u);
-    open_addressing_hashmap_benchmarks::benchmark(2'500'009, 3'800'000u);
+namespace swiss_hashmap_benchmarks {
 
-    std::cout << "OA: test only NOK lookups with almost no hits. WS = 100MB\n";
-    open_addressing_hashmap_benchmarks::benchmark(25'000'109, 8'000'000u);
-    open_addressing_hashmap_benchmarks::benchmark(25'000'109, 18'000'000u);
-    open_addressing_hashmap_benchmarks::benchmark(25'000'109, 26'000'000u);
-    open_addressing_hashmap_benchmarks::benchmark(25'000'109, 38'000'000u);
-    std::cout << std::endl;
-#endif
-    std::cout << "Cuckoo: test only NOK lookups with almost no hits. WS = 2MB\n";
-    cuckoo_hashmap_benchmarks::benchmark(250'013, 200'000u);
-    cuckoo_hashmap_benchmarks::benchmark(250'013, 400'000u);
-    cuckoo_hashmap_benchmarks::benchmark(250'013, 600'000u);
-    cuckoo_hashmap_benchmarks::benchmark(250'013, 900'000u);
+static auto measure(auto &hashmap, const std::vector<int> &lookups_set) {
+    auto t0 = realtime_now();
+    auto found = 0u;
+    for (auto n : lookups_set) {
+        found += static_cast<unsigned>(hashmap.search(n));
+    }
+    auto t1 = realtime_now();
+    return std::make_tuple((t1 - t0)*1.0f/lookups_set.size(), found);
+}
 
-    std::cout << "Cuckoo: test only NOK lookups with almost no hits. WS = 10MB\n";
-    // cuckoo_hashmap_benchmarks::preliminaries();
-    // left capacity + right capacity ~= 2.5M
-    cuckoo_hashmap_benchmarks::benchmark(1'250'009, 800'000u);
-    cuckoo_hashmap_benchmarks::benchmark(1'250'009, 1'800'000u);
-    cuckoo_hashmap_benchmarks::benchmark(1'250'009, 2'600'000u);
-    cuckoo_hashmap_benchmarks::benchmark(1'250'009, 3'800'000u);
+/* All three tables get the same number of slots and the same keys, lookups are 50% hits.
+ * Cuckoo slots = 4 per left bucket + 4 per right bucket.
+ */
+static void benchmark(unsigned slots, float alpha) {
+    constexpr auto uniwersum_size = 2'000'000'000u;
+    swiss::set<> swiss_set(slots, 0.95f);
+    slots = swiss_set.capacity();
+    open_addressing::set<> oa_set(prime(slots), 0.95f);
+    auto left = prime(slots/(2*cuckoo::set<>::slots_per_bucket)), right = prime(left+1);
+    cuckoo::set<> cuckoo_set(left, right);
+    srand(time(nullptr));
+    std::vector<int> inserted, lookups_set;
+    for (auto i = 0u; i < unsigned(alpha*slots); i++) {
+        int item = rand()%uniwersum_size;
+        inserted.push_back(item);
+        swiss_set.insert(item);
+        oa_set.insert(item);
+        cuckoo_set.insert(item);
+    }
+    for (auto i = 0u; i < inserted.size(); i++) {
+        lookups_set.push_back((i%2 == 0)? inserted[rand()%inserted.size()] : int(rand()%uniwersum_size));
+    }
+    swiss_set.collisions = 0;
+    oa_set.collisions = 0;
+    auto [swiss_latency, swiss_found] = measure(swiss_set, lookups_set);
+    auto [oa_latency, oa_found] = measure(oa_set, lookups_set);
+    auto [cuckoo_latency, cuckoo_found] = measure(cuckoo_set, lookups_set);
+    std::cout << "Test only S:    slots = " << slots << " alpha = " << alpha << " searches = " << lookups_set.size()
+              << "\n    swiss:  groups/search = " << 1.0f + 1.0f*swiss_set.collisions/lookups_set.size()
+              << " rehashes = " << swiss_set.rehash_counter << " latency of search op = " << swiss_latency << " ns   found = " << swiss_found
+              << "\n    OA:     colisions/search = " << 1.0f*oa_set.collisions/lookups_set.size()
+              << " rehashes = " << oa_set.rehash_counter << " latency of search op = " << oa_latency << " ns   found = " << oa_found
+              << "\n    cuckoo: rehashes = " << cuckoo_set.rehash_counter << " latency of search op = " << cuckoo_latency
+              << " ns   found = " << cuckoo_found << std::endl;
+}
+}
 
-    std::cout << "Cuckoo: Test only NOK lookups with almost no hits. WS = 100MB\n";
-    cuckoo_hashmap_benchmarks::benchmark(12'500'177, 8'000'000u);
-    cuckoo_hashmap_benchmarks::benchmark(12'500'177, 18'000'000u);
-    cuckoo_hashmap_benchmarks::benchmark(12'500'177, 26'000'000u);
-    cuckoo_hashmap_benchmarks::benchmark(12'500'177, 38'000'000u);
+namespace batched_lookup_benchmarks {
+
+static void measure(auto &hashmap, const std::vector<int> &lookups_set, const char *name) {
+    auto t0 = realtime_now();
+    auto found = 0u;
+    for (auto n : lookups_set) {
+        found += static_cast<unsigned>(hashmap.search(n));
+    }
+    auto t1 = realtime_now();
+    std::cout << "    " << name << " search:            latency of search op = "
+              << (t1 - t0)*1.0f/lookups_set.size() << " ns   found = " << found << std::endl;
+    std::unique_ptr<bool[]> results(new bool[lookups_set.size()]);
+    for (auto group : {1u, 2u, 4u, 8u, 16u, 32u, 64u}) {
+        t0 = realtime_now();
+        found = hashmap.search_many(lookups_set, {results.get(), lookups_set.size()}, group);
+        t1 = realtime_now();
+        std::cout << "    " << name << " search_many group = " << group << ": latency of search op = "
+                  << (t1 - t0)*1.0f/lookups_set.size() << " ns   found = " << found << std::endl;
+    }
+}
+
+static void benchmark(unsigned capacity, unsigned operations_number) {
+    constexpr auto uniwersum_size = 2'000'000'000u;
+    open_addressing::set<> oa_set(capacity);
+    auto left = prime(capacity/(2*cuckoo::set<>::slots_per_bucket)), right = prime(left+1);
+    cuckoo::set<> cuckoo_set(left, right);
+    srand(time(nullptr));
+    std::vector<int> lookups_set;
+    for (auto i = 0u; i < operations_number; i++) {
+        auto operation = get_operation();
+        int item = rand()%uniwersum_size;
+
+        if (operation == 'I') {
+            oa_set.insert(item);
+            cuckoo_set.insert(item);
+        } else {
+            lookups_set.push_back(item);
+        }
+    }
+    // finish any incremental growth so OA takes the prefetching path
+    for (auto i = 0u; i < oa_set.capacity(); i++) {
+        oa_set.search(i);
+    }
+    auto alpha = operations_number*1.0f/(2*capacity);
+    std::cout << "Test only S:    searches = " << lookups_set.size() << " alpha = " << alpha << std::endl;
+    measure(oa_set, lookups_set, "OA");
+    measure(cuckoo_set, lookups_set, "cuckoo");
+}
+}
+
+namespace capacity_policy_benchmarks {
+
+static void measure(auto &hashmap, const std::vector<int> &lookups_set, const char *name) {
+    hashmap.collisions = 0;
+    if constexpr (stats) {
+        perf_enable(fd1);
+    }
+    auto t0 = realtime_now();
+    auto found = 0u;
+    for (auto n : lookups_set) {
+        found += static_cast<unsigned>(hashmap.search(n));
+    }
+    auto t1 = realtime_now();
+    if constexpr (stats) {
+        perf_disable(fd1);
+    }
+    std::cout << "    " << name << ":  capacity = " << hashmap.capacity() << " alpha = "
+              << hashmap.size()*1.0f/hashmap.capacity() << " colisions/search = "
+              << 1.0f*hashmap.collisions/lookups_set.size() << " latency of search op = "
+              << (t1 - t0)*1.0f/lookups_set.size() << " ns   found = " << found << std::endl;
+    if constexpr (stats) {
+        long long count1;
+        read(fd1, &count1, sizeof(count1));
+        std::cout << "    Used " << count1 << " instructions" << std::endl;
+    }
+}
+
+// % by prime on every probe step vs multiply-shift home and masked triangular probing, capacity is power of two
+static void benchmark(unsigned capacity, float alpha) {
+    if constexpr (stats) {
+        perf_init();
+    }
+    constexpr auto uniwersum_size = 2'000'000'000u;
+    open_addressing::set<> prime_set(open_addressing::prime(capacity), 0.95f);
+    open_addressing::set<open_addressing::holder<int>, open_addressing::power_of_two_capacity> pow2_set(capacity, 0.95f);
+    srand(time(nullptr));
+    std::vector<int> lookups_set;
+    for (auto i = 0u; i < unsigned(alpha*capacity); i++) {
+        int item = rand()%uniwersum_size;
+        prime_set.insert(item);
+        pow2_set.insert(item);
+        lookups_set.push_back((i%2 == 0)? item : int(rand()%uniwersum_size));
+    }
+    std::cout << "Test only S:    searches = " << lookups_set.size() << " alpha = " << alpha << std::endl;
+    measure(prime_set, lookups_set, "prime capacity       ");
+    measure(pow2_set, lookups_set, "power of two capacity");
+    if constexpr (stats) {
+        perf_close();
+    }
+}
+}
+
+namespace fast_mod_benchmarks {
+
+template<class Reduce>
+static void measure(const std::vector<unsigned> &keys, Reduce reduce, const char *name) {
+    if constexpr (stats) {
+        perf_enable(fd1);
+    }
+    auto t0 = realtime_now();
+    auto checksum = 0u;
+    for (auto key : keys) {
+        checksum += reduce(key);
+    }
+    auto t1 = realtime_now();
+    if constexpr (stats) {
+        perf_disable(fd1);
+    }
+    std::cout << "    " << name << ":  latency of reduction = " << (t1 - t0)*1.0f/keys.size()
+              << " ns   checksum = " << checksum << std::endl;
+    if constexpr (stats) {
+        long long count1;
+        read(fd1, &count1, sizeof(count1));
+        std::cout << "    Used " << count1 << " instructions, " << count1*1.0f/keys.size()
+                  << " per key" << std::endl;
+    }
+}
+
+// home slot for a runtime prime capacity: div instruction vs precomputed reciprocal
+static void benchmark(unsigned capacity, unsigned keys_number) {
+    if constexpr (stats) {
+        perf_init();
+    }
+    // volatile so that the compiler can't turn % by a known constant into multiplication by itself
+    volatile unsigned runtime_capacity = capacity;
+    const unsigned m = runtime_capacity;
+    const fast_mod modulo(m);
+    srand(time(nullptr));
+    std::vector<unsigned> keys(keys_number);
+    for (auto &key : keys) {
+        key = unsigned(rand());
+    }
+    std::cout << "Test only reduction:    capacity = " << m << " keys = " << keys_number << std::endl;
+    measure(keys, [m](unsigned key) { return key % m; }, "x % m   ");
+    measure(keys, [&modulo](unsigned key) { return modulo(key); }, "fast_mod");
+    if constexpr (stats) {
+        perf_close();
+    }
+}
+}
+
+namespace hasher_benchmarks {
+
+enum class pattern { sequential, strided, clustered };
+
+static const char *pattern_name(pattern keys) {
+    switch (keys) {
+    case pattern::sequential:
+        return "sequential";
+    case pattern::strided:
+        return "strided by 256";
+    default:
+        return "clustered, runs of 16";
+    }
+}
+
+// keys with even index are inserted, odd ones are misses taken from the same pattern
+static std::vector<int> make_keys(pattern keys, unsigned count) {
+    constexpr auto stride = 256u, run = 16u;
+    std::vector<int> result;
+    auto base = unsigned(rand()%1'000'000);
+    for (auto i = 0u; i < count; i++) {
+        switch (keys) {
+        case pattern::sequential:
+            result.push_back(int(base + i));
+            break;
+        case pattern::strided:
+            result.push_back(int(base + i*stride));
+            break;
+        case pattern::clustered:
+            if (i%run == 0) {
+                base = unsigned(rand()%2'000'000'000);
+            }
+            result.push_back(int(base + i%run));
+            break;
+        }
+    }
+    return result;
+}
+
+template<class Hasher>
+static void measure(const std::vector<int> &keys, unsigned capacity, const char *name) {
+    open_addressing::set<open_addressing::holder<int>, open_addressing::prime_capacity, Hasher> oa_set(capacity, 0.95f);
+    auto left = prime(capacity/(2*cuckoo::set<>::slots_per_bucket)), right = prime(left+1);
+    cuckoo::set<int, Hasher> cuckoo_set(left, right);
+    auto t0 = realtime_now();
+    for (auto i = 0u; i < keys.size(); i += 2) {
+        oa_set.insert(keys[i]);
+    }
+    auto t1 = realtime_now();
+    for (auto i = 0u; i < keys.size(); i += 2) {
+        cuckoo_set.insert(keys[i]);
+    }
+    auto t2 = realtime_now();
+    oa_set.collisions = 0;
+    auto oa_found = 0u, cuckoo_found = 0u;
+    for (auto key : keys) {
+        oa_found += static_cast<unsigned>(oa_set.search(key));
+    }
+    auto t3 = realtime_now();
+    for (auto key : keys) {
+        cuckoo_found += static_cast<unsigned>(cuckoo_set.search(key));
+    }
+    auto t4 = realtime_now();
+    const auto inserts = keys.size()/2;
+    std::cout << "    " << name << "\n        OA:     probe length = " << 1.0f + 1.0f*oa_set.collisions/keys.size()
+              << " latency of insert op = " << (t1 - t0)*1.0f/inserts << " ns  latency of search op = "
+              << (t3 - t2)*1.0f/keys.size() << " ns   found = " << oa_found
+              << "\n        cuckoo: rehashes = " << cuckoo_set.rehash_counter << " latency of insert op = "
+              << (t2 - t1)*1.0f/inserts << " ns  latency of search op = " << (t4 - t3)*1.0f/keys.size()
+              << " ns   found = " << cuckoo_found << std::endl;
+}
+
+// same structured keys through every Hasher, searches are 50% hits
+static void benchmark(unsigned capacity, float alpha) {
+    srand(time(nullptr));
+    for (auto keys_pattern : {pattern::sequential, pattern::strided, pattern::clustered}) {
+        const auto keys = make_keys(keys_pattern, 2*unsigned(alpha*capacity));
+        std::cout << "Test I+S:    keys = " << pattern_name(keys_pattern) << " capacity = " << capacity
+                  << " alpha = " << alpha << std::endl;
+        measure<hashers::identity>(keys, capacity, "identity");
+        measure<hashers::murmur3>(keys, capacity, "murmur3 ");
+        measure<hashers::wyhash>(keys, capacity, "wyhash  ");
+    }
+}
+}
+
+namespace robin_hood_benchmarks {
+
+static void measure(auto &hashmap, const std::vector<int> &lookups_set, const char *name) {
+    hashmap.collisions = 0;
+    auto t0 = realtime_now();
+    auto found = 0u;
+    for (auto n : lookups_set) {
+        found += static_cast<unsigned>(hashmap.search(n));
+    }
+    auto t1 = realtime_now();
+    std::cout << "    " << name << ":  colisions/search = " << 1.0f*hashmap.collisions/lookups_set.size()
+              << " latency of search op = " << (t1 - t0)*1.0f/lookups_set.size() << " ns   found = " << found << std::endl;
+}
+
+// quadratic probing with tombstones vs Robin Hood, same prime capacity and keys, lookups with given share of hits
+static void benchmark(unsigned capacity, float alpha) {
+    constexpr auto uniwersum_size = 2'000'000'000u;
+    open_addressing::set<> quadratic_set(capacity, 0.95f);
+    open_addressing::robin_hood_set<> robin_hood_set(capacity, 0.95f);
+    srand(time(nullptr));
+    std::vector<int> inserted;
+    for (auto i = 0u; i < unsigned(alpha*capacity); i++) {
+        int item = rand()%uniwersum_size;
+        inserted.push_back(item);
+        quadratic_set.insert(item);
+        robin_hood_set.insert(item);
+    }
+    for (auto hits : {0.9f, 0.5f, 0.1f}) {
+        std::vector<int> lookups_set;
+        for (auto i = 0u; i < inserted.size(); i++) {
+            lookups_set.push_back((rand()%100 < int(hits*100))? inserted[rand()%inserted.size()] : int(rand()%uniwersum_size));
+        }
+        std::cout << "Test only S:    capacity = " << capacity << " alpha = " << alpha << " hits = " << hits << std::endl;
+        measure(quadratic_set, lookups_set, "quadratic ");
+        measure(robin_hood_set, lookups_set, "Robin Hood");
+    }
+}
+}
+
+namespace concurrent_set_benchmarks {
+
+struct operation {
+    int item;
+    bool insert;
+};
+
+// the same total work split between 1, 2, 4, ... threads, every thread gets its own pregenerated operations
+static void benchmark(unsigned capacity, float prefill_alpha, unsigned operations_number, unsigned inserts_percent) {
+    constexpr auto uniwersum_size = 2'000'000'000u;
+    const auto max_threads = std::max(4u, std::thread::hardware_concurrency());
+    srand(time(nullptr));
+    std::vector<int> prefill;
+    for (auto i = 0u; i < unsigned(prefill_alpha*capacity); i++) {
+        prefill.push_back(rand()%uniwersum_size);
+    }
+    std::vector<operation> operations;
+    for (auto i = 0u; i < operations_number; i++) {
+        if (unsigned(rand()%100) < inserts_percent) {
+            operations.push_back({int(rand()%uniwersum_size), true});
+        } else {
+            operations.push_back({(i%2 == 0)? prefill[rand()%prefill.size()] : int(rand()%uniwersum_size), false});
+        }
+    }
+    std::cout << "Test I+S:    capacity = " << capacity << " alpha before = " << prefill_alpha << " operations = "
+              << operations_number << " inserts = " << inserts_percent << "%" << std::endl;
+    for (auto threads_number = 1u; threads_number <= max_threads; threads_number *= 2) {
+        open_addressing::concurrent_set<> hashmap(capacity);
+        for (auto item : prefill) {
+            hashmap.insert(item);
+        }
+        std::vector<unsigned> collisions(threads_number), searches(threads_number), found(threads_number);
+        std::vector<std::thread> threads;
+        const auto chunk = operations_number/threads_number;
+        auto t0 = realtime_now();
+        for (auto t = 0u; t < threads_number; t++) {
+            threads.emplace_back([&, t] {
+                // thread local counters, written back once
+                auto local_collisions = 0u, local_searches = 0u, local_found = 0u;
+                for (auto k = t*chunk; k < (t + 1)*chunk; k++) {
+                    if (operations[k].insert) {
+                        hashmap.insert(operations[k].item);
+                    } else {
+                        local_found += static_cast<unsigned>(hashmap.search(operations[k].item, local_collisions));
+                        local_searches++;
+                    }
+                }
+                collisions[t] = local_collisions;
+                searches[t] = local_searches;
+                found[t] = local_found;
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        auto t1 = realtime_now();
+        auto all_searches = 0u, all_collisions = 0u, all_found = 0u;
+        for (auto t = 0u; t < threads_number; t++) {
+            all_searches += searches[t];
+            all_collisions += collisions[t];
+            all_found += found[t];
+        }
+        std::cout << "    threads = " << threads_number << "  throughput = " << chunk*threads_number*1000.0f/(t1 - t0)
+                  << " Mops/s   colisions/search = " << 1.0f*all_collisions/std::max(all_searches, 1u)
+                  << "  alpha after = " << hashmap.size()*1.0f/hashmap.capacity() << "  found = " << all_found << std::endl;
+    }
+}
+
+/* Keys 0 .. m-1 take every slot of an identity hashed set, so key m runs through the whole probe
+ * sequence (j up to m/2) in insert and search before both give up. No key may be lost on the way.
+ */
+static void fill_until_full(unsigned capacity) {
+    open_addressing::concurrent_set<> hashmap(capacity);
+    auto item = 0;
+    while (hashmap.insert(item)) {
+        item++;
+    }
+    auto found = 0u;
+    for (auto k = 0; k < item; k++) {
+        found += static_cast<unsigned>(hashmap.search(k));
+    }
+    const auto rejected_found = hashmap.search(item);
+    std::cout << "Test I until full:    capacity = " << capacity << " inserted = " << item << " found = " << found
+              << " rejected found = " << rejected_found << std::endl;
+    assert(unsigned(item) == capacity && found == capacity && !rejected_found);
+}
+}
+
+namespace sharded_set_benchmarks {
+
+using concurrent_set_benchmarks::operation;
+
+// runs body(first, last) over the operations split between threads_number threads, returns Mops/s
+template<class Body>
+static float run(unsigned threads_number, const std::vector<operation> &operations, Body body) {
+    std::vector<std::thread> threads;
+    const auto chunk = operations.size()/threads_number;
+    auto t0 = realtime_now();
+    for (auto t = 0u; t < threads_number; t++) {
+        threads.emplace_back(body, t*chunk, (t + 1)*chunk);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto t1 = realtime_now();
+    return chunk*threads_number*1000.0f/(t1 - t0);
+}
+
+template<class Set>
+static void measure(Set &hashmap, const std::vector<int> &prefill, const std::vector<operation> &operations,
+                    unsigned threads_number, const char *name) {
+    hashmap.insert_many(prefill);
+    auto single = run(threads_number, operations, [&](std::size_t first, std::size_t last) {
+        for (auto k = first; k < last; k++) {
+            if (operations[k].insert) {
+                hashmap.insert(operations[k].item);
+            } else {
+                hashmap.search(operations[k].item);
+            }
+        }
+    });
+    // every thread collects inserts and searches in separate batches of 256 and flushes a full one
+    auto batched = run(threads_number, operations, [&](std::size_t first, std::size_t last) {
+        constexpr auto batch_size = 256u;
+        std::vector<int> inserts, searches;
+        bool found[batch_size];
+        for (auto k = first; k < last; k++) {
+            auto &batch = operations[k].insert? inserts : searches;
+            batch.push_back(operations[k].item);
+            if (inserts.size() == batch_size) {
+                hashmap.insert_many(inserts);
+                inserts.clear();
+            }
+            if (searches.size() == batch_size) {
+                hashmap.search_many(searches, found);
+                searches.clear();
+            }
+        }
+        hashmap.insert_many(inserts);
+        hashmap.search_many(searches, {found, searches.size()});
+    });
+    std::cout << "    " << name << ":  throughput = " << single << " Mops/s   batched = " << batched << " Mops/s" << std::endl;
+}
+
+// global std::mutex around one table vs 64 shards, same operations on 1, 2, 4, ... threads
+static void benchmark(unsigned capacity, unsigned operations_number, unsigned inserts_percent) {
+    constexpr auto uniwersum_size = 2'000'000'000u;
+    constexpr auto shards = 64u;
+    const auto max_threads = std::max(4u, std::thread::hardware_concurrency());
+    srand(time(nullptr));
+    std::vector<int> prefill;
+    for (auto i = 0u; i < capacity/4; i++) {
+        prefill.push_back(rand()%uniwersum_size);
+    }
+    std::vector<operation> operations;
+    for (auto i = 0u; i < operations_number; i++) {
+        if (unsigned(rand()%100) < inserts_percent) {
+            operations.push_back({int(rand()%uniwersum_size), true});
+        } else {
+            operations.push_back({(i%2 == 0)? prefill[rand()%prefill.size()] : int(rand()%uniwersum_size), false});
+        }
+    }
+    std::cout << "Test I+S:    capacity = " << capacity << " operations = " << operations_number
+              << " inserts = " << inserts_percent << "%" << std::endl;
+    const auto left = prime(capacity/shards/(2*cuckoo::set<>::slots_per_bucket)), right = prime(left + 1);
+    for (auto threads_number = 1u; threads_number <= max_threads; threads_number *= 2) {
+        std::cout << "  threads = " << threads_number << std::endl;
+        sharded::set<open_addressing::set<>, std::mutex> global(1, capacity);
+        measure(global, prefill, operations, threads_number, "OA, one std::mutex          ");
+        sharded::set<open_addressing::set<>> spinlocked(shards, capacity/shards);
+        measure(spinlocked, prefill, operations, threads_number, "OA, 64 spinlocked shards    ");
+        sharded::set<cuckoo::set<>, std::shared_mutex> shared(shards, left, right);
+        measure(shared, prefill, operations, threads_number, "cuckoo, 64 shared_mutex shards");
+    }
+}
+}
+
+namespace concurrent_cuckoo_benchmarks {
+
+using concurrent_set_benchmarks::operation;
+
+// starts small so the operations go through several concurrent resizes, readers included
+static void benchmark(unsigned capacity, unsigned operations_number, unsigned inserts_percent) {
+    constexpr auto uniwersum_size = 2'000'000'000u;
+    const auto max_threads = std::max(4u, std::thread::hardware_concurrency());
+    srand(time(nullptr));
+    std::vector<int> prefill;
+    for (auto i = 0u; i < capacity/4; i++) {
+        prefill.push_back(rand()%uniwersum_size);
+    }
+    std::vector<operation> operations;
+    for (auto i = 0u; i < operations_number; i++) {
+        if (unsigned(rand()%100) < inserts_percent) {
+            operations.push_back({int(rand()%uniwersum_size), true});
+        } else {
+            operations.push_back({(i%2 == 0)? prefill[rand()%prefill.size()] : int(rand()%uniwersum_size), false});
+        }
+    }
+    std::cout << "Test I+S:    capacity = " << capacity << " operations = " << operations_number
+              << " inserts = " << inserts_percent << "%" << std::endl;
+    const auto left = prime(capacity/(2*cuckoo::set<>::slots_per_bucket)), right = prime(left + 1);
+    for (auto threads_number = 1u; threads_number <= max_threads; threads_number *= 2) {
+        cuckoo::concurrent_set<> hashmap(capacity/20, prime(capacity/20 + 1));
+        for (auto item : prefill) {
+            hashmap.insert(item);
+        }
+        const auto rehashes_before = hashmap.rehash_counter.load();
+        auto found = std::atomic<unsigned>(0);
+        auto throughput = sharded_set_benchmarks::run(threads_number, operations, [&](std::size_t first, std::size_t last) {
+            auto hits = 0u;
+            for (auto k = first; k < last; k++) {
+                if (operations[k].insert) {
+                    hashmap.insert(operations[k].item);
+                } else {
+                    hits += hashmap.search(operations[k].item);
+                }
+            }
+            found += hits;
+        });
+        sharded::set<cuckoo::set<>, std::shared_mutex> shared(1, left, right);
+        shared.insert_many(prefill);
+        auto global = sharded_set_benchmarks::run(threads_number, operations, [&](std::size_t first, std::size_t last) {
+            for (auto k = first; k < last; k++) {
+                if (operations[k].insert) {
+                    shared.insert(operations[k].item);
+                } else {
+                    shared.search(operations[k].item);
+                }
+            }
+        });
+        std::cout << "  threads = " << threads_number << ":  throughput = " << throughput << " Mops/s   found = " << found
+                  << "   resizes = " << hashmap.rehash_counter - rehashes_before
+                  << "   one std::shared_mutex = " << global << " Mops/s" << std::endl;
+    }
+}
+}
+
+namespace cuckoo_eviction_benchmarks {
+
+/* Random walk vs BFS eviction path on the same keys. Max alpha is the load factor reached just before
+ * the first rehash of a table with the given left capacity; then keys_number keys are inserted
+ * starting from a small table, with average and worst insert latency (worst one includes rehashes).
+ */
+template<class Eviction>
+static void measure(unsigned left, const std::vector<int> &keys, const char *name) {
+    const auto slots = cuckoo::set<>::slots_per_bucket*(left + prime(left + 1));
+    cuckoo::set<int, hashers::identity, Eviction> bounded(left, prime(left + 1));
+    auto inserted = 0u;
+    for (; inserted < keys.size() && bounded.rehash_counter == 0; inserted++) {
+        bounded.insert(keys[inserted]);
+    }
+    cuckoo::set<int, hashers::identity, Eviction> growing(101, prime(102));
+    auto worst = uint64_t(0);
+    auto t0 = realtime_now();
+    for (auto item : keys) {
+        auto t1 = realtime_now();
+        growing.insert(item);
+        worst = std::max(worst, realtime_now() - t1);
+    }
+    auto t1 = realtime_now();
+    std::cout << "    " << name << ": max alpha = " << (inserted - 1)*1.0f/slots << "   rehashes = " << growing.rehash_counter
+              << "   final alpha = " << growing.size()*1.0f/(cuckoo::set<>::slots_per_bucket*(std::get<0>(growing.capacities()) + std::get<1>(growing.capacities())))
+              << "   latency of insert op = " << (t1 - t0)*1.0f/keys.size() << " ns   worst = " << worst/1000 << " us" << std::endl;
+}
+
+static void benchmark(unsigned left, unsigned keys_number) {
+    constexpr auto uniwersum_size = 2'000'000'000u;
+    srand(time(nullptr));
+    std::vector<int> keys;
+    for (auto i = 0u; i < keys_number; i++) {
+        keys.push_back(rand()%uniwersum_size);
+    }
+    std::cout << "Test only I:    left = " << left << " keys = " << keys_number << std::endl;
+    measure<cuckoo::random_walk>(left, keys, "random walk");
+    measure<cuckoo::bfs_path>(left, keys, "BFS path   ");
+}
+}
+
+namespace cuckoo_bucket_benchmarks {
+
+// same number of slots in 4-way and 8-way buckets, filled to alpha, lookups are 50% hits
+template<unsigned Slots>
+static void measure(unsigned slots, float alpha, const std::vector<int> &keys, const std::vector<int> &lookups_set) {
+    const auto left = prime(slots/(2*Slots));
+    cuckoo::set<int, hashers::identity, cuckoo::bfs_path, Slots> hashmap(left, prime(left + 1));
+    for (auto i = 0u; i < unsigned(alpha*slots); i++) {
+        hashmap.insert(keys[i]);
+    }
+    auto t0 = realtime_now();
+    auto found = 0u;
+    for (auto n : lookups_set) {
+        found += static_cast<unsigned>(hashmap.search(n));
+    }
+    auto t1 = realtime_now();
+    std::unique_ptr<bool[]> results(new bool[lookups_set.size()]);
+    auto t2 = realtime_now();
+    hashmap.search_many(lookups_set, {results.get(), lookups_set.size()});
+    auto t3 = realtime_now();
+    std::cout << "    " << Slots << "-way: rehashes = " << hashmap.rehash_counter << "   latency of search op = "
+              << (t1 - t0)*1.0f/lookups_set.size() << " ns   search_many = " << (t3 - t2)*1.0f/lookups_set.size()
+              << " ns   found = " << found << std::endl;
+}
+
+static void benchmark(unsigned slots, float alpha) {
+    constexpr auto uniwersum_size = 2'000'000'000u;
+    srand(time(nullptr));
+    std::vector<int> keys, lookups_set;
+    for (auto i = 0u; i < slots; i++) {
+        keys.push_back(rand()%uniwersum_size);
+    }
+    const auto inserted = unsigned(alpha*slots);
+    for (auto i = 0u; i < inserted; i++) {
+        lookups_set.push_back((i%2 == 0)? keys[rand()%inserted] : int(rand()%uniwersum_size));
+    }
+    std::cout << "Test only S:    slots = " << slots << " alpha = " << alpha << " searches = " << lookups_set.size() << std::endl;
+    measure<4>(slots, alpha, keys, lookups_set);
+    measure<8>(slots, alpha, keys, lookups_set);
+}
+}
+
+namespace cuckoo_resize_benchmarks {
+
+// peak RSS since last reset_peak_rss(), in MB, from VmHWM of /proc/self/status
+static unsigned peak_rss() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.starts_with("VmHWM:")) {
+            return unsigned(std::stoul(line.substr(6))/1024);
+        }
+    }
+    return 0;
+}
+
+static void reset_peak_rss() {
+    std::ofstream("/proc/self/clear_refs") << "5";
+}
+
+/* Grows a table from 101 buckets by inserting keys_number keys. Longest single insert shows how long
+ * a resize stalls the caller, peak RSS how much memory old and new tables need together.
+ */
+template<class Set>
+static void measure(Set &hashmap, const std::vector<int> &keys, const char *name) {
+    auto worst = uint64_t(0);
+    auto t0 = realtime_now();
+    for (auto item : keys) {
+        auto t1 = realtime_now();
+        hashmap.insert(item);
+        worst = std::max(worst, realtime_now() - t1);
+    }
+    auto t1 = realtime_now();
+    std::cout << "    " << name << ": rehashes = " << hashmap.rehash_counter << "   latency of insert op = "
+              << (t1 - t0)*1.0f/keys.size() << " ns   longest insert = " << worst/1000 << " us   peak RSS = "
+              << peak_rss() << " MB" << std::endl;
+}
+
+static void benchmark(unsigned keys_number) {
+    constexpr auto uniwersum_size = 2'000'000'000u;
+    srand(time(nullptr));
+    std::vector<int> keys;
+    for (auto i = 0u; i < keys_number; i++) {
+        keys.push_back(rand()%uniwersum_size);
+    }
+    std::cout << "Test only I:    keys = " << keys_number << "   keys alone = " << keys_number*sizeof(int)/(1024*1024)
+              << " MB" << std::endl;
+    {
+        reset_peak_rss();
+        cuckoo::set<> hashmap(101, 103);
+        measure(hashmap, keys, "cuckoo");
+    }
+    {
+        reset_peak_rss();
+        open_addressing::set<> hashmap(101, 0.75f);
+        measure(hashmap, keys, "OA    ");
+    }
+}
+}
+
+namespace cuckoo_stash_benchmarks {
+
+/* Tables of the same capacity are filled with the same keys up to alpha, with no stash and with stashes
+ * of 8 and 16 keys. Max alpha is the load factor reached just before the first rehash.
+ */
+template<class Eviction, unsigned Stash>
+static void measure(unsigned left, float alpha, const std::vector<int> &keys, const char *name) {
+    const auto right = prime(left + 1);
+    const auto slots = cuckoo::set<>::slots_per_bucket*(left + right);
+    cuckoo::set<int, hashers::identity, Eviction, cuckoo::set<>::slots_per_bucket, Stash> hashmap(left, right);
+    auto worst = uint64_t(0);
+    auto t0 = realtime_now();
+    for (auto i = 0u; i < unsigned(alpha*slots); i++) {
+        auto t1 = realtime_now();
+        hashmap.insert(keys[i]);
+        worst = std::max(worst, realtime_now() - t1);
+    }
+    auto t1 = realtime_now();
+    const auto rehashes = hashmap.rehash_counter, stashed = hashmap.stash_size();
+    cuckoo::set<int, hashers::identity, Eviction, cuckoo::set<>::slots_per_bucket, Stash> bounded(left, right);
+    auto inserted = 0u;
+    for (; inserted < keys.size() && bounded.rehash_counter == 0; inserted++) {
+        bounded.insert(keys[inserted]);
+    }
+    std::cout << "    " << name << " stash = " << Stash << ":\trehashes = " << rehashes << "   stashed = " << stashed
+              << "   max alpha = " << (inserted - 1)*1.0f/slots << "   latency of insert op = "
+              << (t1 - t0)*1.0f/unsigned(alpha*slots) << " ns   worst = " << worst/1000 << " us" << std::endl;
+}
+
+static void benchmark(unsigned left, float alpha) {
+    constexpr auto uniwersum_size = 2'000'000'000u;
+    srand(time(nullptr));
+    std::vector<int> keys;
+    for (auto i = 0u; i < 4*cuckoo::set<>::slots_per_bucket*left; i++) {
+        keys.push_back(rand()%uniwersum_size);
+    }
+    std::cout << "Test only I:    left = " << left << " alpha = " << alpha << std::endl;
+    measure<cuckoo::random_walk, 0>(left, alpha, keys, "random walk");
+    measure<cuckoo::random_walk, 8>(left, alpha, keys, "random walk");
+    measure<cuckoo::random_walk, 16>(left, alpha, keys, "random walk");
+    measure<cuckoo::bfs_path, 0>(left, alpha, keys, "BFS path   ");
+    measure<cuckoo::bfs_path, 8>(left, alpha, keys, "BFS path   ");
+    measure<cuckoo::bfs_path, 16>(left, alpha, keys, "BFS path   ");
+}
+}
+
+namespace cuckoo_reseed_benchmarks {
+
+using hasher_benchmarks::pattern;
+
+/* Fixed capacity tables filled to alpha with random and structured keys. Cycles are inserts that found
+ * no room (stashed or not), every reseed is a rehash at the same capacity instead of a growth.
+ */
+template<class Hasher>
+static void measure(const std::vector<int> &keys, unsigned left, const char *name) {
+    cuckoo::set<int, Hasher> hashmap(left, prime(left + 1));
+    auto t0 = realtime_now();
+    for (auto item : keys) {
+        hashmap.insert(item);
+    }
+    auto t1 = realtime_now();
+    std::cout << "    " << name << ": cycles = " << hashmap.cycles << "   reseeds = " << hashmap.reseed_counter
+              << "   rehashes = " << hashmap.rehash_counter << "   stashed = " << hashmap.stash_size()
+              << "   latency of insert op = " << (t1 - t0)*1.0f/keys.size() << " ns" << std::endl;
+}
+
+static void benchmark(unsigned left, float alpha) {
+    constexpr auto uniwersum_size = 2'000'000'000u;
+    srand(time(nullptr));
+    const auto count = unsigned(alpha*cuckoo::set<>::slots_per_bucket*(left + prime(left + 1)));
+    std::vector<int> random_keys;
+    for (auto i = 0u; i < count; i++) {
+        random_keys.push_back(rand()%uniwersum_size);
+    }
+    std::cout << "Test only I:    keys = random left = " << left << " alpha = " << alpha << std::endl;
+    measure<hashers::identity>(random_keys, left, "identity");
+    measure<hashers::murmur3>(random_keys, left, "murmur3 ");
+    // x % left is the same for all of them, one fixed function can place only one bucket worth on the left
+    std::vector<int> multiples;
+    for (auto i = 0u; i < count/2; i++) {
+        multiples.push_back(int((i*uint64_t(left)) % uniwersum_size));
+    }
+    std::cout << "Test only I:    keys = multiples of left left = " << left << " alpha = " << alpha/2 << std::endl;
+    measure<hashers::identity>(multiples, left, "identity");
+    for (auto keys_pattern : {pattern::sequential, pattern::strided, pattern::clustered}) {
+        const auto keys = hasher_benchmarks::make_keys(keys_pattern, count);
+        std::cout << "Test only I:    keys = " << hasher_benchmarks::pattern_name(keys_pattern) << " left = " << left
+                  << " alpha = " << alpha << std::endl;
+        measure<hashers::identity>(keys, left, "identity");
+        measure<hashers::murmur3>(keys, left, "murmur3 ");
+    }
+}
+}
+
+namespace cuckoo_filter_benchmarks {
+
+template<class Filter>
+static void measure_filter(const std::vector<int> &keys, const std::vector<int> &lookups_set, const char *name) {
+    Filter filter(keys.size());
+    for (auto item : keys) {
+        filter.insert(item);
+    }
+    auto t0 = realtime_now();
+    auto found = 0u;
+    for (auto n : lookups_set) {
+        found += static_cast<unsigned>(filter.contains(n));
+    }
+    auto t1 = realtime_now();
+    std::cout << "    " << name << ": throughput = " << lookups_set.size()*1000.0f/(t1 - t0) << " Mlookups/s   bits/key = "
+              << filter.bits_per_key() << "   found = " << found << "   expected FPR = " << Filter::false_positive_rate << std::endl;
+}
+
+/* keys_number keys, lookups are 90% misses - the filter case. Filter found count over the exact one
+ * divided by misses is the measured false positive rate.
+ */
+static void benchmark(unsigned keys_number) {
+    constexpr auto uniwersum_size = 2'000'000'000u;
+    srand(time(nullptr));
+    std::vector<int> keys, lookups_set;
+    for (auto i = 0u; i < keys_number; i++) {
+        keys.push_back(rand()%uniwersum_size);
+    }
+    for (auto i = 0u; i < keys_number; i++) {
+        lookups_set.push_back((i%10 == 0)? keys[rand()%keys.size()] : int(rand()%uniwersum_size));
+    }
+    std::cout << "Test only S:    keys = " << keys_number << " lookups = " << lookups_set.size() << " 10% hits" << std::endl;
+    const auto left = prime(unsigned(keys_number/0.9f)/(2*cuckoo::set<>::slots_per_bucket));
+    cuckoo::set<> exact(left, prime(left + 1));
+    for (auto item : keys) {
+        exact.insert(item);
+    }
+    auto t0 = realtime_now();
+    auto found = 0u;
+    for (auto n : lookups_set) {
+        found += static_cast<unsigned>(exact.search(n));
+    }
+    auto t1 = realtime_now();
+    auto [nleft, nright] = exact.capacities();
+    std::cout << "    cuckoo::set:       throughput = " << lookups_set.size()*1000.0f/(t1 - t0) << " Mlookups/s   bits/key = "
+              << 8.0f*sizeof(int)*cuckoo::set<>::slots_per_bucket*(nleft + nright)/keys_number << "   found = " << found << std::endl;
+    measure_filter<cuckoo::filter<8>>(keys, lookups_set, "cuckoo::filter<8> ");
+    measure_filter<cuckoo::filter<12>>(keys, lookups_set, "cuckoo::filter<12>");
+    measure_filter<cuckoo::filter<16>>(keys, lookups_set, "cuckoo::filter<16>");
+}
+}
+
+namespace bloom_filter_benchmarks {
+
+template<class Set>
+static void measure(Set &hashmap, const std::vector<int> &lookups_set, const char *name) {
+    hashmap.collisions = 0;
+    auto t0 = realtime_now();
+    auto found = 0u;
+    for (auto n : lookups_set) {
+        found += static_cast<unsigned>(hashmap.search(n));
+    }
+    auto t1 = realtime_now();
+    std::cout << "    " << name << ": latency of search op = " << (t1 - t0)*1.0f/lookups_set.size() << " ns   colisions/search = "
+              << 1.0f*hashmap.collisions/lookups_set.size() << "   found = " << found << std::endl;
+}
+
+/* Same keys in OA set with and without blocked Bloom filter in front. A filtered miss costs one
+ * filter cache line instead of a probe sequence, a hit pays for both.
+ */
+static void benchmark(unsigned capacity, float alpha) {
+    using filtered_set = open_addressing::set<open_addressing::holder<int>, open_addressing::prime_capacity,
+                                              hashers::identity, bloom::blocked>;
+    constexpr auto uniwersum_size = 2'000'000'000u;
+    constexpr auto lookups_number = 10'000'000u;
+    srand(time(nullptr));
+    open_addressing::set<> plain(capacity, 0.95f);
+    filtered_set filtered(capacity, 0.95f);
+    std::vector<int> keys;
+    for (auto i = 0u; i < unsigned(alpha*plain.capacity()); i++) {
+        keys.push_back(rand()%uniwersum_size);
+        plain.insert(keys.back());
+        filtered.insert(keys.back());
+    }
+    std::cout << "Test only S:    capacity = " << plain.capacity() << " alpha = " << alpha << " searches = "
+              << lookups_number << std::endl;
+    for (auto hits : {0u, 10u, 50u, 90u, 100u}) {
+        std::vector<int> lookups_set;
+        for (auto i = 0u; i < lookups_number; i++) {
+            lookups_set.push_back((unsigned(rand()%100) < hits)? keys[rand()%keys.size()] : int(rand()%uniwersum_size));
+        }
+        std::cout << "  hits = " << hits << "%" << std::endl;
+        measure(plain, lookups_set, "bloom::none   ");
+        measure(filtered, lookups_set, "bloom::blocked");
+    }
+}
+}
+
+namespace huge_page_benchmarks {
+
+template<class Set, class... Args>
+static void measure(const std::vector<int> &keys, const std::vector<int> &lookups_set, const char *name, Args... args) {
+    if constexpr (stats) {
+        perf_init();
+    }
+    auto t0 = realtime_now();
+    Set hashmap(args...);
+    auto t1 = realtime_now();
+    for (auto item : keys) {
+        hashmap.insert(item);
+    }
+    auto t2 = realtime_now();
+    if constexpr (stats) {
+        perf_enable(fd4);
+    }
+    auto found = 0u;
+    for (auto n : lookups_set) {
+        found += static_cast<unsigned>(hashmap.search(n));
+    }
+    if constexpr (stats) {
+        perf_disable(fd4);
+    }
+    auto t3 = realtime_now();
+    std::cout << "    " << name << ": construction = " << (t1 - t0)/1'000'000 << " ms   latency of insert op = "
+              << (t2 - t1)*1.0f/keys.size() << " ns   latency of search op = " << (t3 - t2)*1.0f/lookups_set.size()
+              << " ns   found = " << found;
+    if constexpr (stats) {
+        long long count4;
+        read(fd4, &count4, sizeof(count4));
+        std::cout << "   dTLB-load-misses/search = " << count4*1.0f/lookups_set.size();
+        perf_close();
+    }
+    std::cout << std::endl;
+}
+
+/* slots in total for both sets, alpha 0.75, lookups are 50% hits. Construction time shows eager fill
+ * vs lazy zero-fill, search latency and dTLB misses show 4KB vs 2MB pages.
+ */
+static void benchmark(unsigned slots) {
+    constexpr auto uniwersum_size = 2'000'000'000u;
+    srand(time(nullptr));
+    std::vector<int> keys, lookups_set;
+    // 0 and -1 are empty slots of holder<int, 0> and holder<int>
+    for (auto i = 0u; i < unsigned(0.75f*slots); i++) {
+        keys.push_back(int(rand()%uniwersum_size) + 1);
+    }
+    for (auto i = 0u; i < 10'000'000u; i++) {
+        lookups_set.push_back((i%2 == 0)? keys[rand()%keys.size()] : int(rand()%uniwersum_size) + 1);
+    }
+    std::cout << "Test I+S:    slots = " << slots << " keys = " << keys.size() << " searches = " << lookups_set.size() << std::endl;
+
+    using namespace open_addressing;
+    const auto capacity = prime(slots);
+    measure<set<holder<int>>>(keys, lookups_set, "OA holder<int>     heap      ", capacity);
+    measure<set<holder<int, 0>, prime_capacity, hashers::identity, bloom::none, allocation::heap>>(
+        keys, lookups_set, "OA holder<int, 0>  heap      ", capacity);
+    measure<set<holder<int, 0>, prime_capacity, hashers::identity, bloom::none, allocation::huge_pages>>(
+        keys, lookups_set, "OA holder<int, 0>  huge_pages", capacity);
+    measure<set<holder<int, 0>, prime_capacity, hashers::identity, bloom::none, allocation::hugetlb>>(
+        keys, lookups_set, "OA holder<int, 0>  hugetlb   ", capacity);
+
+    using cuckoo::bfs_path;
+    const auto left = prime(slots/(2*cuckoo::set<>::slots_per_bucket));
+    const auto right = prime(left + 1);
+    measure<cuckoo::set<>>(keys, lookups_set, "Cuckoo             heap      ", left, right);
+    measure<cuckoo::set<int, hashers::identity, bfs_path, 4, 8, allocation::huge_pages>>(
+        keys, lookups_set, "Cuckoo             huge_pages", left, right);
+    measure<cuckoo::set<int, hashers::identity, bfs_path, 4, 8, allocation::hugetlb>>(
+        keys, lookups_set, "Cuckoo             hugetlb   ", left, right);
+    std::cout << "    hugetlb fallbacks to huge_pages = " << allocation::hugetlb::fallbacks << std::endl;
+}
+}
+
+namespace snapshot_benchmarks {
+
+/* Rebuild: construct and insert every key. Cold start: load() of the snapshot and the same lookups,
+ * page faults included. File stays in page cache, so this is a warm restart of a service.
+ */
+template<class Set, class... Args>
+static void measure(const std::vector<int> &keys, const std::vector<int> &lookups_set, const char *name, Args... args) {
+    const auto file_name = (std::filesystem::temp_directory_path()/"fast_stdlib_snapshot.bin").string();
+    auto t0 = realtime_now();
+    auto found = 0u;
+    {
+        Set hashmap(args...);
+        for (auto item : keys) {
+            hashmap.insert(item);
+        }
+        for (auto n : lookups_set) {
+            found += static_cast<unsigned>(hashmap.search(n));
+        }
+        t0 = realtime_now() - t0;
+        hashmap.save(file_name);
+    }
+    auto t1 = realtime_now();
+    auto loaded = Set::load(file_name);
+    auto t2 = realtime_now();
+    auto loaded_found = 0u;
+    for (auto n : lookups_set) {
+        loaded_found += static_cast<unsigned>(loaded.search(n));
+    }
+    auto t3 = realtime_now();
+    std::cout << "    " << name << ": rebuild + searches = " << t0/1'000'000 << " ms   load = " << (t2 - t1)/1'000
+              << " us   load + searches = " << (t3 - t1)/1'000'000 << " ms   file = "
+              << std::filesystem::file_size(file_name)/(1024*1024) << " MB   found = " << found << "/" << loaded_found << std::endl;
+    std::filesystem::remove(file_name);
+}
+
+static void benchmark(unsigned keys_number) {
+    constexpr auto uniwersum_size = 2'000'000'000u;
+    srand(time(nullptr));
+    std::vector<int> keys, lookups_set;
+    for (auto i = 0u; i < keys_number; i++) {
+        keys.push_back(int(rand()%uniwersum_size));
+    }
+    for (auto i = 0u; i < 1'000'000u; i++) {
+        lookups_set.push_back((i%2 == 0)? keys[rand()%keys.size()] : int(rand()%uniwersum_size));
+    }
+    std::cout << "Test I+S:    keys = " << keys_number << " searches = " << lookups_set.size() << " 50% hits" << std::endl;
+    measure<open_addressing::set<>>(keys, lookups_set, "OA    ", open_addressing::prime(unsigned(keys_number/0.7f)));
+    const auto left = prime(unsigned(keys_number/0.9f)/(2*cuckoo::set<>::slots_per_bucket));
+    measure<cuckoo::set<>>(keys, lookups_set, "Cuckoo", left, prime(left + 1));
+}
+}
+
+namespace bulk_build_benchmarks {
+
+/* insert() loop vs set::build() with 1 to N threads into a set sized for alpha 0.7,
+ * throughput in Mkeys/s. Every build gets a fresh set, table allocation is not measured.
+ */
+static void benchmark(unsigned keys_number) {
+    constexpr auto uniwersum_size = 2'000'000'000u;
+    srand(time(nullptr));
+    std::vector<int> keys;
+    for (auto i = 0u; i < keys_number; i++) {
+        keys.push_back(int(rand()%uniwersum_size));
+    }
+    const auto capacity = open_addressing::prime(unsigned(keys_number/0.7f));
+    std::cout << "Test only I:    keys = " << keys_number << " capacity = " << capacity << std::endl;
+    {
+        open_addressing::set<> hashmap(capacity);
+        auto t0 = realtime_now();
+        for (auto item : keys) {
+            hashmap.insert(item);
+        }
+        auto t1 = realtime_now();
+        std::cout << "    insert loop:        throughput = " << keys_number*1000.0f/(t1 - t0) << " Mkeys/s   size = "
+                  << hashmap.size() << std::endl;
+    }
+    const auto max_threads = std::max(4u, std::thread::hardware_concurrency());
+    for (auto threads_number = 1u; threads_number <= max_threads; threads_number *= 2) {
+        open_addressing::set<> hashmap(capacity);
+        auto t0 = realtime_now();
+        hashmap.build(keys, executors::threads(threads_number));
+        auto t1 = realtime_now();
+        std::cout << "    build, threads = " << threads_number << ": throughput = " << keys_number*1000.0f/(t1 - t0)
+                  << " Mkeys/s   size = " << hashmap.size() << std::endl;
+    }
+}
+}
+
+namespace frozen_set_benchmarks {
+
+/* Same keys in frozen::set and OA set at alpha 0.7, against raw_array_access style lookups
+ * into a vector of the same size by random position: one memory access per lookup is the floor.
+ */
+static void benchmark(unsigned keys_number) {
+    constexpr auto uniwersum_size = 2'000'000'000u;
+    constexpr auto lookups_number = 10'000'000u;
+    srand(time(nullptr));
+    std::vector<int> keys;
+    for (auto i = 0u; i < keys_number; i++) {
+        keys.push_back(int(rand()%uniwersum_size));
+    }
+    std::vector<int> lookups_set, positions;
+    for (auto i = 0u; i < lookups_number; i++) {
+        lookups_set.push_back((rand()%2 == 0)? keys[rand()%keys.size()] : int(rand()%uniwersum_size));
+        positions.push_back(int(rand()%keys.size()));
+    }
+    std::cout << "Test only S:    keys = " << keys_number << " searches = " << lookups_number << std::endl;
+    {
+        auto t0 = realtime_now();
+        auto found = 0u;
+        for (auto n : positions) {
+            found += static_cast<unsigned>(keys[n] != -1);
+        }
+        auto t1 = realtime_now();
+        std::cout << "    raw array:     latency of search op = " << (t1 - t0)*1.0f/lookups_number << " ns   found = "
+                  << found << std::endl;
+    }
+    {
+        auto t0 = realtime_now();
+        frozen::set<> frozen_set(keys);
+        auto t1 = realtime_now();
+        auto found = 0u;
+        for (auto n : lookups_set) {
+            found += static_cast<unsigned>(frozen_set.contains(n));
+        }
+        auto t2 = realtime_now();
+        std::cout << "    frozen::set:   latency of search op = " << (t2 - t1)*1.0f/lookups_number << " ns   found = "
+                  << found << "   build = " << (t1 - t0)/1000000 << " ms   bits/key = " << frozen_set.bits_per_key()
+                  << "   rebuilds = " << frozen_set.rebuilds << "   evictions = " << frozen_set.evictions << std::endl;
+    }
+    {
+        auto t0 = realtime_now();
+        open_addressing::set<> hashmap(open_addressing::prime(unsigned(keys_number/0.7f)));
+        hashmap.build(keys);
+        auto t1 = realtime_now();
+        auto found = 0u;
+        for (auto n : lookups_set) {
+            found += static_cast<unsigned>(hashmap.search(n));
+        }
+        auto t2 = realtime_now();
+        std::cout << "    OA set:        latency of search op = " << (t2 - t1)*1.0f/lookups_number << " ns   found = "
+                  << found << "   build = " << (t1 - t0)/1000000 << " ms   bits/key = "
+                  << (8.0f*sizeof(int)*hashmap.capacity())/hashmap.size() - 8.0f*sizeof(int) << std::endl;
+    }
+}
+}
+
+int main() {
+    std::cout << "Test raw access to vector as reference. WS = 2MB\n";
+    raw_array_access::benchmark(500'009, 200'000u);
+    raw_array_access::benchmark(500'009, 400'000u);
+    raw_array_access::benchmark(500'009, 600'000u);
+    raw_array_access::benchmark(500'009, 900'000u);
+
+    std::cout << "Test raw access to vector as reference. WS = 10MB\n";
+    raw_array_access::benchmark(2'500'009, 800'000u);
+    raw_array_access::benchmark(2'500'009, 1'800'000u);
+    raw_array_access::benchmark(2'500'009, 2'600'000u);
+    raw_array_access::benchmark(2'500'009, 3'800'000u);
+
+    std::cout << "Test raw access to vector as reference. WS = 100MB\n";
+    raw_array_access::benchmark(25'000'109, 8'000'000u);
+    raw_array_access::benchmark(25'000'109, 18'000'000u);
+    raw_array_access::benchmark(25'000'109, 26'000'000u);
+    raw_array_access::benchmark(25'000'109, 38'000'000u);
+    std::cout << std::endl;
+#if 0
+    std::cout << "OA: test only NOK lookups with almost no hits. WS = 2MB\n";
+    open_addressing_hashmap_benchmarks::benchmark(500'009, 200'000u);
+    open_addressing_hashmap_benchmarks::benchmark(500'009, 400'000u);
+    open_addressing_hashmap_benchmarks::benchmark(500'009, 600'000u);
+    open_addressing_hashmap_benchmarks::benchmark(500'009, 900'000u);
+
+    std::cout << "OA: test only NOK lookups with almost no hits. WS = 10MB\n";
+    open_addressing_hashmap_benchmarks::benchmark(2'500'009, 800'000u);
+    open_addressing_hashmap_benchmarks::benchmark(2'500'009, 1'800'000u);
+    open_addressing_hashmap_benchmarks::benchmark(2'500'009, 2'600'000u);
+    open_addressing_hashmap_benchmarks::benchmark(2'500'009, 3'800'000u);
+
+    std::cout << "OA: test only NOK lookups with almost no hits. WS = 100MB\n";
+    open_addressing_hashmap_benchmarks::benchmark(25'000'109, 8'000'000u);
+    open_addressing_hashmap_benchmarks::benchmark(25'000'109, 18'000'000u);
+    open_addressing_hashmap_benchmarks::benchmark(25'000'109, 26'000'000u);
+    open_addressing_hashmap_benchmarks::benchmark(25'000'109, 38'000'000u);
+    std::cout << std::endl;
+#endif
+    std::cout << "OA map vs std::unordered_map<int,int>: test only NOK lookups with almost no hits. WS = 2MB\n";
+    open_addressing_map_benchmarks::benchmark(500'009, 200'000u);
+    open_addressing_map_benchmarks::benchmark(500'009, 400'000u);
+    open_addressing_map_benchmarks::benchmark(500'009, 600'000u);
+    open_addressing_map_benchmarks::benchmark(500'009, 900'000u);
+
+    std::cout << "OA map vs std::unordered_map<int,int>: test only NOK lookups with almost no hits. WS = 10MB\n";
+    open_addressing_map_benchmarks::benchmark(2'500'009, 800'000u);
+    open_addressing_map_benchmarks::benchmark(2'500'009, 1'800'000u);
+    open_addressing_map_benchmarks::benchmark(2'500'009, 2'600'000u);
+    open_addressing_map_benchmarks::benchmark(2'500'009, 3'800'000u);
+
+    std::cout << "OA map vs std::unordered_map<int,int>: test only NOK lookups with almost no hits. WS = 100MB\n";
+    open_addressing_map_benchmarks::benchmark(25'000'109, 8'000'000u);
+    open_addressing_map_benchmarks::benchmark(25'000'109, 18'000'000u);
+    open_addressing_map_benchmarks::benchmark(25'000'109, 26'000'000u);
+    open_addressing_map_benchmarks::benchmark(25'000'109, 38'000'000u);
+    std::cout << std::endl;
+    std::cout << "OA: test insert/erase churn at alpha = 0.5, 400M operations. WS = 10MB\n";
+    open_addressing_churn_benchmarks::benchmark(2'500'009, 0.5f, 20, 10'000'000u);
+    std::cout << std::endl;
+    std::cout << "Swiss vs OA vs Cuckoo: test only S with 50% hits. WS = 8MB\n";
+    for (auto alpha : {0.4f, 0.5f, 0.6f, 0.7f, 0.8f, 0.9f}) {
+        swiss_hashmap_benchmarks::benchmark(2'000'000u, alpha);
+    }
+    std::cout << std::endl;
+    std::cout << "OA and Cuckoo: batched lookups with prefetching, group size sweep. WS = 10MB\n";
+    batched_lookup_benchmarks::benchmark(2'500'009, 2'600'000u);
+    std::cout << "OA and Cuckoo: batched lookups with prefetching, group size sweep. WS = 100MB\n";
+    batched_lookup_benchmarks::benchmark(25'000'109, 26'000'000u);
+    std::cout << std::endl;
+    std::cout << "OA: prime vs power of two capacity, 50% hits. WS = 10MB\n";
+    for (auto alpha : {0.5f, 0.75f, 0.85f}) {
+        capacity_policy_benchmarks::benchmark(2'097'152u, alpha);
+    }
+    std::cout << "OA: prime vs power of two capacity, 50% hits. WS = 80MB\n";
+    for (auto alpha : {0.5f, 0.75f, 0.85f}) {
+        capacity_policy_benchmarks::benchmark(16'777'216u, alpha);
+    }
+    std::cout << std::endl;
+    std::cout << "Reduction to a runtime prime capacity, % vs fast_mod\n";
+    fast_mod_benchmarks::benchmark(2'500'009, 10'000'000u);
+    fast_mod_benchmarks::benchmark(25'000'109, 10'000'000u);
+    std::cout << std::endl;
+
+    std::cout << "Structured keys, identity vs mixing Hasher\n";
+    hasher_benchmarks::benchmark(2'500'009, 0.5f);
+    hasher_benchmarks::benchmark(2'500'009, 0.75f);
+    std::cout << std::endl;
+
+    std::cout << "OA: quadratic vs Robin Hood probing, hit-heavy and miss-heavy lookups\n";
+    robin_hood_benchmarks::benchmark(2'500'009, 0.5f);
+    robin_hood_benchmarks::benchmark(2'500'009, 0.75f);
+    robin_hood_benchmarks::benchmark(2'500'009, 0.9f);
+    std::cout << std::endl;
+
+    std::cout << "OA: lock-free concurrent set, 1 to N threads, read-mostly and 50/50. WS = 100MB\n";
+    concurrent_set_benchmarks::benchmark(25'000'109, 0.25f, 20'000'000u, 10);
+    concurrent_set_benchmarks::benchmark(25'000'109, 0.25f, 20'000'000u, 50);
+    concurrent_set_benchmarks::fill_until_full(100'003);
+    std::cout << std::endl;
+
+    std::cout << "Sharded sets vs one global lock, 1 to N threads, read-mostly and 50/50. WS = 100MB\n";
+    sharded_set_benchmarks::benchmark(25'000'109, 20'000'000u, 10);
+    sharded_set_benchmarks::benchmark(25'000'109, 20'000'000u, 50);
+    std::cout << std::endl;
+
+    std::cout << "Cuckoo: concurrent set with seqlock readers, 1 to N threads, read-mostly and 50/50. WS = 100MB\n";
+    concurrent_cuckoo_benchmarks::benchmark(25'000'109, 20'000'000u, 5);
+    concurrent_cuckoo_benchmarks::benchmark(25'000'109, 20'000'000u, 50);
+    std::cout << std::endl;
+
+    std::cout << "Cuckoo: random walk vs BFS eviction path, max load factor and rehashes\n";
+    cuckoo_eviction_benchmarks::benchmark(100'003, 1'000'000u);
+    cuckoo_eviction_benchmarks::benchmark(1'000'003, 10'000'000u);
+    std::cout << std::endl;
+
+    std::cout << "Cuckoo: 4-way vs 8-way buckets with SIMD compare, 50% hits. WS = 10MB and 100MB\n";
+    cuckoo_bucket_benchmarks::benchmark(2'500'000, 0.9f);
+    cuckoo_bucket_benchmarks::benchmark(25'000'000, 0.9f);
+    std::cout << std::endl;
+
+    std::cout << "Cuckoo vs OA: incremental resize, longest insert and peak RSS\n";
+    cuckoo_resize_benchmarks::benchmark(1'250'000u);
+    cuckoo_resize_benchmarks::benchmark(12'500'000u);
+    std::cout << std::endl;
+
+    std::cout << "Cuckoo: overflow stash, rehashes and worst insert up to alpha\n";
+    cuckoo_stash_benchmarks::benchmark(100'003, 0.85f);
+    cuckoo_stash_benchmarks::benchmark(100'003, 0.95f);
+    cuckoo_stash_benchmarks::benchmark(1'000'003, 0.95f);
+    std::cout << std::endl;
+
+    std::cout << "Cuckoo: seeded hash pair, cycles, reseeds and rehashes up to alpha\n";
+    cuckoo_reseed_benchmarks::benchmark(100'003, 0.9f);
+    cuckoo_reseed_benchmarks::benchmark(1'000'003, 0.95f);
+    std::cout << std::endl;
+
+    std::cout << "Cuckoo filter vs exact cuckoo set, 90% negative lookups\n";
+    cuckoo_filter_benchmarks::benchmark(1'000'000u);
+    cuckoo_filter_benchmarks::benchmark(10'000'000u);
+    std::cout << std::endl;
+
+    std::cout << "OA with blocked Bloom filter front-end, hit ratio sweep. WS = 10MB and 100MB\n";
+    bloom_filter_benchmarks::benchmark(open_addressing::prime(1'250'000), 0.9f);
+    bloom_filter_benchmarks::benchmark(open_addressing::prime(12'500'000), 0.9f);
+    std::cout << std::endl;
+
+    std::cout << "OA and Cuckoo: heap vs THP vs hugetlb table storage, lazy zero-fill. WS = 100MB\n";
+    huge_page_benchmarks::benchmark(25'000'000u);
+    std::cout << std::endl;
+
+    std::cout << "OA and Cuckoo: cold start from mmap snapshot vs rebuild from keys\n";
+    snapshot_benchmarks::benchmark(1'000'000u);
+    snapshot_benchmarks::benchmark(10'000'000u);
+    std::cout << std::endl;
+
+    std::cout << "OA: parallel bulk build vs insert loop, 1 to N threads\n";
+    bulk_build_benchmarks::benchmark(10'000'000u);
+    bulk_build_benchmarks::benchmark(30'000'000u);
+    bulk_build_benchmarks::benchmark(100'000'000u);
+    std::cout << std::endl;
+
+    std::cout << "Frozen perfect hash set vs raw array access and OA, 50% hits\n";
+    frozen_set_benchmarks::benchmark(1'000'000u);
+    frozen_set_benchmarks::benchmark(10'000'000u);
+    std::cout << std::endl;
+
+    std::cout << "OA: test growth from small capacity, only inserts\n";
+    open_addressing_growth_benchmarks::benchmark(10'007, 200'000u);
+    open_addressing_growth_benchmarks::benchmark(10'007, 2'000'000u);
+    open_addressing_growth_benchmarks::benchmark(10'007, 20'000'000u);
+    std::cout << std::endl;
+    std::cout << "Cuckoo: test only NOK lookups with almost no hits. WS = 2MB\n";
+    cuckoo_hashmap_benchmarks::benchmark(250'013, 200'000u);
+    cuckoo_hashmap_benchmarks::benchmark(250'013, 400'000u);
+    cuckoo_hashmap_benchmarks::benchmark(250'013, 600'000u);
+    cuckoo_hashmap_benchmarks::benchmark(250'013, 900'000u);
+
+    std::cout << "Cuckoo: test only NOK lookups with almost no hits. WS = 10MB\n";
+    // cuckoo_hashmap_benchmarks::preliminaries();
+    // left capacity + right capacity ~= 2.5M
+    cuckoo_hashmap_benchmarks::benchmark(1'250'009, 800'000u);
+    cuckoo_hashmap_benchmarks::benchmark(1'250'009, 1'800'000u);
+    cuckoo_hashmap_benchmarks::benchmark(1'250'009, 2'600'000u);
+    cuckoo_hashmap_benchmarks::benchmark(1'250'009, 3'800'000u);
+
+    std::cout << "Cuckoo: Test only NOK lookups with almost no hits. WS = 100MB\n";
+    cuckoo_hashmap_benchmarks::benchmark(12'500'177, 8'000'000u);
+    cuckoo_hashmap_benchmarks::benchmark(12'500'177, 18'000'000u);
+    cuckoo_hashmap_benchmarks::benchmark(12'500'177, 26'000'000u);
+    cuckoo_hashmap_benchmarks::benchmark(12'500'177, 38'000'000u);
+
+    std::cout << "Hopscotch: test only NOK lookups with almost no hits. WS = 2MB\n";
+    hopscotch_hashmap_benchmarks::benchmark(500'009, 200'000u);
+    hopscotch_hashmap_benchmarks::benchmark(500'009, 400'000u);
+    hopscotch_hashmap_benchmarks::benchmark(500'009, 600'000u);
+    hopscotch_hashmap_benchmarks::benchmark(500'009, 900'000u);
+
+    std::cout << "Hopscotch: test only NOK lookups with almost no hits. WS = 10MB\n";
+    hopscotch_hashmap_benchmarks::benchmark(2'500'009, 800'000u);
+    hopscotch_hashmap_benchmarks::benchmark(2'500'009, 1'800'000u);
+    hopscotch_hashmap_benchmarks::benchmark(2'500'009, 2'600'000u);
+    hopscotch_hashmap_benchmarks::benchmark(2'500'009, 3'800'000u);
+
+    std::cout << "Hopscotch: test only NOK lookups with almost no hits. WS = 100MB\n";
+    hopscotch_hashmap_benchmarks::benchmark(25'000'109, 8'000'000u);
+    hopscotch_hashmap_benchmarks::benchmark(25'000'109, 18'000'000u);
+    hopscotch_hashmap_benchmarks::benchmark(25'000'109, 26'000'000u);
+    hopscotch_hashmap_benchmarks::benchmark(25'000'109, 38'000'000u);
     return 0;
 }
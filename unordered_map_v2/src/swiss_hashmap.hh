@@ -0,0 +1,186 @@
+#pragma once
+
+#include <type_traits>
+#include <limits>
+#include <cassert>
+#include <cstdint>
+#include <algorithm>
+#include <emmintrin.h>
+
+namespace swiss {
+
+/* Slots are split into groups of 16. Next to the slot array there is a control array with one
+ * byte per slot: the low 7 bits of hash when the slot is full, or one of the empty/deleted markers
+ * (both with the sign bit set). A probe loads the 16 control bytes of a group, compares them with
+ * the key's 7-bit tag in one _mm_cmpeq_epi8 and only touches slots whose tag matched.
+ * Groups are visited in triangular order (g, g+1, g+3, g+6, ...) which covers every group when
+ * their number is a power of two.
+ */
+template<class T = int>
+class set {
+    static_assert(std::is_integral_v<T>);
+public:
+    set(const set&) = delete;
+    set& operator=(const set&) = delete;
+
+    using key_type = T;
+    set(unsigned size, float load_factor = 0.875f)
+        : max_load_factor(load_factor) {
+        assert(max_load_factor > 0.0f && max_load_factor < 1.0f);
+        auto groups = 1u;
+        while (groups*group_size < size) {
+            groups *= 2;
+        }
+        allocate(groups);
+    }
+
+    ~set() {
+        delete[] slots;
+        delete[] ctrl;
+    }
+
+    void insert(T item) {
+        const auto hash = mix(item);
+        if (find(item, hash) >= 0) {
+            return;
+        }
+        if (n + deleted >= grow_threshold) {
+            rehash();
+        }
+        auto i = find_free(hash);
+        if (ctrl[i] == deleted_ctrl) {
+            deleted--;
+        }
+        ctrl[i] = h2(hash);
+        slots[i] = item;
+        n++;
+    }
+
+    void erase(T item) {
+        auto i = find(item, mix(item));
+        if (i < 0) {
+            return;
+        }
+        // a probe reaching a group with an empty byte stops there anyway, so no chain is cut
+        auto group = i & ~(group_size - 1);
+        if (match(group, empty_ctrl)) {
+            ctrl[i] = empty_ctrl;
+        } else {
+            ctrl[i] = deleted_ctrl;
+            deleted++;
+        }
+        n--;
+    }
+
+    bool search(T item) const {
+        return find(item, mix(item)) >= 0;
+    }
+
+    unsigned size() const {
+        return n;
+    }
+
+    unsigned capacity() const {
+        return groups_mask*group_size + group_size;
+    }
+
+    mutable unsigned collisions = 0;
+    unsigned rehash_counter = 0;
+private:
+    constexpr static unsigned group_size = 16;
+    constexpr static int8_t empty_ctrl = -128;
+    constexpr static int8_t deleted_ctrl = -2;
+
+    // group index comes from the low bits, so fold the strong high half of the product into them
+    static uint64_t mix(T item) {
+        auto hash = static_cast<uint64_t>(item)*0x9E3779B97F4A7C15ull;
+        return hash ^ (hash >> 32);
+    }
+
+    static int8_t h2(uint64_t hash) {
+        return static_cast<int8_t>(hash >> 57);
+    }
+
+    unsigned h1(uint64_t hash) const {
+        return static_cast<unsigned>(hash >> 7) & groups_mask;
+    }
+
+    unsigned match(unsigned group, int8_t tag) const {
+        auto control = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl + group));
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(control, _mm_set1_epi8(tag)));
+    }
+
+    // empty and deleted are the only negative control bytes
+    unsigned match_free(unsigned group) const {
+        auto control = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl + group));
+        return _mm_movemask_epi8(control);
+    }
+
+    int find(T item, uint64_t hash) const {
+        const auto tag = h2(hash);
+        auto g = h1(hash);
+        for (auto step = 1u; ; step++) {
+            const auto group = g*group_size;
+            for (auto bits = match(group, tag); bits; bits &= bits - 1) {
+                auto i = group + __builtin_ctz(bits);
+                if (slots[i] == item) {
+                    return i;
+                }
+            }
+            if (match(group, empty_ctrl)) {
+                return -1;
+            }
+            collisions++;
+            g = (g + step) & groups_mask;
+        }
+    }
+
+    unsigned find_free(uint64_t hash) const {
+        auto g = h1(hash);
+        for (auto step = 1u; ; step++) {
+            const auto group = g*group_size;
+            if (auto bits = match_free(group)) {
+                return group + __builtin_ctz(bits);
+            }
+            g = (g + step) & groups_mask;
+        }
+    }
+
+    void allocate(unsigned groups) {
+        groups_mask = groups - 1;
+        ctrl = new int8_t[capacity()];
+        slots = new T[capacity()];
+        std::fill_n(ctrl, capacity(), empty_ctrl);
+        grow_threshold = std::min(unsigned(max_load_factor*capacity()), capacity() - 1);
+    }
+
+    void rehash() {
+        rehash_counter++;
+        auto old_ctrl = ctrl;
+        auto old_slots = slots;
+        auto old_capacity = capacity();
+        // only grow when the table is really full, otherwise just drop deleted markers
+        allocate((n >= grow_threshold/2)? 2*(groups_mask + 1) : groups_mask + 1);
+        deleted = 0;
+        for (auto i = 0u; i < old_capacity; i++) {
+            if (old_ctrl[i] >= 0) {
+                const auto hash = mix(old_slots[i]);
+                auto j = find_free(hash);
+                ctrl[j] = h2(hash);
+                slots[j] = old_slots[i];
+            }
+        }
+        delete[] old_slots;
+        delete[] old_ctrl;
+    }
+
+    unsigned n = 0;
+    unsigned deleted = 0;
+    float max_load_factor;
+    unsigned grow_threshold = 0;
+    unsigned groups_mask = 0;
+    int8_t *ctrl = nullptr;
+    T *slots = nullptr;
+};
+
+}